@@ -9,6 +9,18 @@
 			"src/node_fuse.cc",
 			"src/reply.cc",
 			"src/event.cc",
+			"src/request_queue.cc",
+			"src/request_slab.cc",
+			"src/name_cache.cc",
+			"src/receive_pool.cc",
+			"src/splice_pipe.cc",
+			"src/write_buffer.cc",
+			"src/read_ahead.cc",
+			"src/native_handler.cc",
+			"src/admission.cc",
+			"src/timing_wheel.cc",
+			"src/channel.cc",
+			"src/thread.cc",
 		],
 		"cflags": [
 			"-D_FILE_OFFSET_BITS=64",
@@ -23,7 +35,8 @@
 		],
 		"link_settings": {
 			"libraries": [
-				"<!@(pkg-config --libs-only-l fuse)"
+				"<!@(pkg-config --libs-only-l fuse)",
+				"-ldl"
 			]
 		}
 	}]
@@ -2,7 +2,10 @@ var util = require('util');
 var events = require('events');
 var bindings = require('./bindings');
 
-var FileSystem = function() {};
+var FileSystem = function() {
+    // Own emitter, so notices of one mount do not reach another
+    this.events = new events.EventEmitter();
+};
 
 (function() {
     this.events = new events.EventEmitter();
@@ -650,6 +653,28 @@ fuse.fuse_version = bindings.fuse_version;
 
 module.exports = {
     fuse: fuse,
+    Fuse: bindings.Fuse,
     FileSystem: FileSystem,
-    PosixError: PosixError
+    PosixError: PosixError,
+
+    // Low level api, see "Request ids"
+    replyEntry: bindings.replyEntry,
+    replyAttr: bindings.replyAttr,
+    replyReadlink: bindings.replyReadlink,
+    replyErr: bindings.replyErr,
+    replyOpen: bindings.replyOpen,
+    replyBuffer: bindings.replyBuffer,
+    replyFd: bindings.replyFd,
+    replyBuffers: bindings.replyBuffers,
+    replyWrite: bindings.replyWrite,
+    replyStatfs: bindings.replyStatfs,
+    replyCreate: bindings.replyCreate,
+    replyXattr: bindings.replyXattr,
+    replyLock: bindings.replyLock,
+    replyBmap: bindings.replyBmap,
+    replyAddDirEntry: bindings.replyAddDirEntry,
+    requestAborted: bindings.requestAborted,
+    OPEN_DIRECT_IO: bindings.OPEN_DIRECT_IO,
+    OPEN_KEEP_CACHE: bindings.OPEN_KEEP_CACHE,
+    OPEN_NONSEEKABLE: bindings.OPEN_NONSEEKABLE
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "admission.h"
+
+// How long a throttled FUSE thread sleeps before checking again
+// in case a wakeup was missed, in nanoseconds.
+#define ADMISSION_RECHECK_NS 10000000
+
+namespace NodeFuse {
+	Admission::Admission() {
+		max_inflight = 0;
+		reject_errno = 0;
+		inflight = 0;
+		throttled = 0;
+		rejected = 0;
+		waiters = 0;
+		session = NULL;
+
+		for (int op = 0; op < OP_COUNT; op++) {
+			op_max_inflight[op] = 0;
+			op_inflight[op] = 0;
+		}
+
+		uv_mutex_init(&mutex);
+		uv_cond_init(&cond);
+	}
+
+	Admission::~Admission() {
+		uv_cond_destroy(&cond);
+		uv_mutex_destroy(&mutex);
+	}
+
+	bool Admission::Full(int op) {
+		return (max_inflight > 0 && inflight >= max_inflight) ||
+		       (op_max_inflight[op] > 0 && op_inflight[op] >= op_max_inflight[op]);
+	}
+
+	bool Admission::Acquire(int op) {
+		bool counted = false;
+
+		for (;;) {
+			uint32_t total = __sync_add_and_fetch(&inflight, 1);
+			uint32_t current = __sync_add_and_fetch(&op_inflight[op], 1);
+
+			if ((max_inflight == 0 || total <= max_inflight) &&
+			    (op_max_inflight[op] == 0 || current <= op_max_inflight[op])) {
+				return true;
+			}
+
+			__sync_sub_and_fetch(&inflight, 1);
+			__sync_sub_and_fetch(&op_inflight[op], 1);
+
+			if (reject_errno != 0) {
+				__sync_fetch_and_add(&rejected, 1);
+				return false;
+			}
+
+			if (!counted) {
+				__sync_fetch_and_add(&throttled, 1);
+				counted = true;
+			}
+
+			// Stop reading from the kernel until a reply frees a slot
+			uv_mutex_lock(&mutex);
+			__sync_fetch_and_add(&waiters, 1);
+
+			bool exited = false;
+
+			while (Full(op)) {
+				// The thread runs with cancellation disabled, unmount
+				// would hang joining it if it kept waiting
+				if (session != NULL && fuse_session_exited(session)) {
+					exited = true;
+					break;
+				}
+
+				uv_cond_timedwait(&cond, &mutex, ADMISSION_RECHECK_NS);
+			}
+
+			__sync_fetch_and_sub(&waiters, 1);
+			uv_mutex_unlock(&mutex);
+
+			if (exited) {
+				return false;
+			}
+		}
+	}
+
+	bool Admission::TryAcquire(int op) {
+		uint32_t total = __sync_add_and_fetch(&inflight, 1);
+		uint32_t current = __sync_add_and_fetch(&op_inflight[op], 1);
+
+		if ((max_inflight == 0 || total <= max_inflight) &&
+		    (op_max_inflight[op] == 0 || current <= op_max_inflight[op])) {
+			return true;
+		}
+
+		__sync_sub_and_fetch(&inflight, 1);
+		__sync_sub_and_fetch(&op_inflight[op], 1);
+
+		return false;
+	}
+
+	void Admission::Release(int op) {
+		__sync_sub_and_fetch(&inflight, 1);
+		__sync_sub_and_fetch(&op_inflight[op], 1);
+
+		if (waiters > 0) {
+			uv_mutex_lock(&mutex);
+			uv_cond_broadcast(&cond);
+			uv_mutex_unlock(&mutex);
+		}
+	}
+} // namespace NodeFuse
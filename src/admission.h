@@ -0,0 +1,47 @@
+#ifndef SRC_ADMISSION_H_
+#define SRC_ADMISSION_H_
+#include <stdint.h>
+#include <uv.h>
+#include <fuse_lowlevel.h>
+#include "operations.h"
+
+namespace NodeFuse {
+	// Bounds the number of requests handed to javascript that have not
+	// been replied yet, globally and per operation. A limit of 0 means
+	// unlimited. Acquire runs on the FUSE threads, Release on the loop.
+	class Admission {
+		public:
+			Admission();
+			virtual ~Admission();
+
+			// Returns false when the request has to be failed with
+			// reject_errno, blocks while full when reject_errno is 0.
+			// Also false once the session exited, the request is
+			// failed with ENOTCONN then if reject_errno is 0.
+			bool Acquire(int op);
+			void Release(int op);
+			// Takes a slot without waiting, false when full. For
+			// requests the event loop makes itself.
+			bool TryAcquire(int op);
+
+			unsigned int max_inflight;
+			unsigned int op_max_inflight[OP_COUNT];
+			int reject_errno;
+			// Set once created, blocked threads give up when it exits
+			struct fuse_session *session;
+
+			volatile uint32_t inflight;
+			volatile uint32_t op_inflight[OP_COUNT];
+			volatile uint64_t throttled;
+			volatile uint64_t rejected;
+
+		private:
+			bool Full(int op);
+
+			uv_mutex_t mutex;
+			uv_cond_t cond;
+			volatile int waiters;
+	};
+} // namespace NodeFuse
+
+#endif // SRC_ADMISSION_H
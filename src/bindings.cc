@@ -1,5 +1,9 @@
 // Copyright 2012, Camilo Aguilar. Cloudescape, LLC.
 #include "bindings.h"
+#include "event.h"
+#include "reply.h"
+#include "name_cache.h"
+#include "read_ahead.h"
 
 namespace NodeFuse {
 	Persistent<FunctionTemplate> Fuse::constructor_template;
@@ -7,8 +11,149 @@ namespace NodeFuse {
 	// static Persistent<String> mountpoint_sym;
 	static Persistent<String> filesystem_sym;
 	static Persistent<String> options_sym;
-	
-	static Persistent<Object> CI;
+
+	// libfuse routes SIGINT/SIGTERM/SIGHUP to a single session,
+	// the first mount of the process owns them.
+	static struct fuse_session *signal_session = NULL;
+
+	FUSE_SYM(queues);
+	FUSE_SYM(meta);
+	FUSE_SYM(data);
+	static Persistent<String> default_sym = NODE_PSYMBOL("default");
+	FUSE_SYM(depth);
+	FUSE_SYM(enqueued);
+	FUSE_SYM(dispatched);
+	FUSE_SYM(admission);
+	FUSE_SYM(inflight);
+	FUSE_SYM(throttled);
+	FUSE_SYM(rejected);
+	FUSE_SYM(interrupts);
+	FUSE_SYM(received);
+	FUSE_SYM(replied);
+	FUSE_SYM(timeouts);
+	FUSE_SYM(expired);
+	FUSE_SYM(late);
+	FUSE_SYM(abandoned);
+	FUSE_SYM(descriptors);
+	FUSE_SYM(capacity);
+	FUSE_SYM(used);
+	FUSE_SYM(peak);
+	FUSE_SYM(overflows);
+	FUSE_SYM(names);
+	FUSE_SYM(hits);
+	FUSE_SYM(misses);
+	FUSE_SYM(buffers);
+	FUSE_SYM(allocated);
+	FUSE_SYM(claimed);
+	FUSE_SYM(readahead);
+	FUSE_SYM(prefetched);
+	FUSE_SYM(wasted);
+
+	static const struct fuse_opt fusejs_opts[] = {
+		FUSEJS_OPT("threads=%u", threads),
+		FUSEJS_OPT("batch_max=%u", batch_max),
+		FUSEJS_OPT("batch_time=%u", batch_time),
+		FUSEJS_OPT("native=%s", native),
+		FUSEJS_OPT("weight_meta=%u", weight_meta),
+		FUSEJS_OPT("weight_default=%u", weight_default),
+		FUSEJS_OPT("weight_data=%u", weight_data),
+		FUSEJS_OPT("max_inflight=%u", max_inflight),
+		FUSEJS_OPT("throttle=%s", throttle),
+		FUSEJS_OPT("timeout=%u", timeout),
+		FUSEJS_OPT("timeout_reply=%s", timeout_reply),
+		FUSEJS_OPT("clone_fd", clone_fd),
+		FUSEJS_OPT("rx_cpus=%s", rx_cpus),
+		FUSEJS_OPT("loop_cpus=%s", loop_cpus),
+		FUSEJS_OPT("readahead=%u", readahead),
+		FUSE_OPT_END
+	};
+
+	// Indexed by Operation, used for per operation options
+	static const char *operation_names[OP_COUNT] = {
+		"init",
+		"destroy",
+		"lookup",
+		"forget",
+		"getattr",
+		"setattr",
+		"readlink",
+		"mknod",
+		"mkdir",
+		"unlink",
+		"rmdir",
+		"symlink",
+		"rename",
+		"link",
+		"open",
+		"read",
+		"write",
+		"flush",
+		"release",
+		"fsync",
+		"opendir",
+		"readdir",
+		"releasedir",
+		"fsyncdir",
+		"statfs",
+		"setxattr",
+		"getxattr",
+		"listxattr",
+		"removexattr",
+		"access",
+		"create",
+		"getlk",
+		"setlk",
+		"bmap",
+	};
+
+	// Prefixes of the per operation options, <prefix><operation>=N
+	static const char *operation_option_prefixes[] = {
+		"max_inflight_",
+		"timeout_",
+	};
+
+	// Picks up the per operation options, everything else
+	// is left for fuse_parse_cmdline and fuse_mount.
+	static int ParseOption(void *data, const char *arg, int key, struct fuse_args *outargs) {
+		Fuse::Options *options = reinterpret_cast<Fuse::Options *>(data);
+		unsigned int *values[] = {
+			options->op_max_inflight,
+			options->op_timeout,
+		};
+
+		if (key != FUSE_OPT_KEY_OPT) {
+			return 1;
+		}
+
+		for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+			const char *prefix = operation_option_prefixes[i];
+			size_t prefix_len = strlen(prefix);
+
+			if (strncmp(arg, prefix, prefix_len) != 0) {
+				continue;
+			}
+
+			const char *name = arg + prefix_len;
+			const char *value = strchr(name, '=');
+
+			if (value == NULL) {
+				return 1;
+			}
+
+			for (int op = 0; op < OP_COUNT; op++) {
+				if (strlen(operation_names[op]) == (size_t) (value - name) &&
+				    strncmp(operation_names[op], name, value - name) == 0) {
+					values[i][op] = strtoul(value + 1, NULL, 10);
+					return 0;
+				}
+			}
+
+			fprintf(stderr, "fuse: unknown operation in option %s\n", arg);
+			return -1;
+		}
+
+		return 1;
+	}
 
 	void Fuse::Initialize(Handle<Object> target) {
 		Local<FunctionTemplate> t = FunctionTemplate::New(Fuse::New);
@@ -16,6 +161,8 @@ namespace NodeFuse {
 		t->InstanceTemplate()->SetInternalFieldCount(1);
 
 		NODE_SET_PROTOTYPE_METHOD(t, "mount", Fuse::Mount);
+		NODE_SET_PROTOTYPE_METHOD(t, "refresh", Fuse::Refresh);
+		NODE_SET_PROTOTYPE_METHOD(t, "stats", Fuse::Stats);
 		// NODE_SET_PROTOTYPE_METHOD(t, "unmount", Fuse::Unmount);
 
 		constructor_template = Persistent<FunctionTemplate>::New(t);
@@ -29,7 +176,19 @@ namespace NodeFuse {
 		options_sym           = NODE_PSYMBOL("options");
 	}
 
-	Fuse::Fuse() : ObjectWrap() {}
+	Fuse::Fuse() : ObjectWrap() {
+		userdata = NULL;
+		native_failed = NULL;
+		rx_cpus.count = 0;
+		request_ids = false;
+
+		for (int op = 0; op < OP_COUNT; op++) {
+			arity[op] = 0;
+			context[op] = true;
+			copy[op] = false;
+			splice[op] = false;
+		}
+	}
 	Fuse::~Fuse() {
 		if (fargs != NULL) {
 			fuse_opt_free_args(fargs);
@@ -63,9 +222,39 @@ namespace NodeFuse {
 		Baton *baton = reinterpret_cast<Baton *>(args);
 		Fuse *fuse = ObjectWrap::Unwrap<Fuse>(baton->currentInstance);
 
+		Thread::SetName("fuse-mount");
+
 		fuse->fargs = &baton->fargs;
 		fuse->fsobj = baton->fsobj;
 
+		fuse->options.threads = FUSEJS_DEFAULT_THREADS;
+		fuse->options.batch_max = FUSEJS_DEFAULT_BATCH_MAX;
+		fuse->options.batch_time = FUSEJS_DEFAULT_BATCH_TIME;
+		fuse->options.native = NULL;
+		fuse->options.weight_meta = FUSEJS_DEFAULT_WEIGHT_META;
+		fuse->options.weight_default = FUSEJS_DEFAULT_WEIGHT_DEFAULT;
+		fuse->options.weight_data = FUSEJS_DEFAULT_WEIGHT_DATA;
+
+		fuse->options.max_inflight = 0;
+		fuse->options.throttle = NULL;
+
+		fuse->options.timeout = 0;
+		fuse->options.timeout_reply = NULL;
+		fuse->options.clone_fd = 0;
+		fuse->options.rx_cpus = NULL;
+		fuse->options.loop_cpus = NULL;
+		fuse->options.readahead = 0;
+
+		for (int op = 0; op < OP_COUNT; op++) {
+			fuse->options.op_max_inflight[op] = 0;
+			fuse->options.op_timeout[op] = 0;
+		}
+
+		if (fuse_opt_parse(fuse->fargs, &fuse->options, fusejs_opts, ParseOption) == -1) {
+			FUSEJS_THROW_EXCEPTION("Error parsing fuse options: ", strerror(errno));
+			return;
+		}
+
 		int ret = fuse_parse_cmdline(fuse->fargs, &fuse->mountpoint, &fuse->multithreaded, &fuse->foreground);
 
 		if (ret == -1) {
@@ -82,47 +271,382 @@ namespace NodeFuse {
 
 		struct fuse_lowlevel_ops *operations = FileSystem::GetOperations();
 
-		Userdata *userdata = new Userdata();
+		FileSystem::Userdata *userdata = baton->userdata;
 		userdata->fuse = fuse;
-		userdata->async = &baton->s_async;
+
+		// Given in KiB, the smallest window is the least it can be
+		userdata->readahead->max_window = (size_t) fuse->options.readahead * 1024;
+		if (userdata->readahead->max_window > 0 && userdata->readahead->max_window < FUSEJS_READAHEAD_MIN_WINDOW) {
+			userdata->readahead->max_window = FUSEJS_READAHEAD_MIN_WINDOW;
+		}
+
+		Admission *admission = userdata->admission;
+		admission->max_inflight = fuse->options.max_inflight;
+
+		for (int op = 0; op < OP_COUNT; op++) {
+			admission->op_max_inflight[op] = fuse->options.op_max_inflight[op];
+		}
+
+		if (fuse->options.throttle != NULL) {
+			if (strcmp(fuse->options.throttle, "eagain") == 0) {
+				admission->reject_errno = EAGAIN;
+			} else if (strcmp(fuse->options.throttle, "ebusy") == 0) {
+				admission->reject_errno = EBUSY;
+			} else if (strcmp(fuse->options.throttle, "block") != 0) {
+				fprintf(stderr, "fuse: invalid throttle mode %s\n", fuse->options.throttle);
+			}
+
+			free(fuse->options.throttle);
+			fuse->options.throttle = NULL;
+		}
+
+		// Init and destroy are not requests, they never time out
+		for (int op = 0; op < OP_COUNT; op++) {
+			unsigned int timeout = fuse->options.op_timeout[op] > 0 ? fuse->options.op_timeout[op] : fuse->options.timeout;
+
+			if (op != OP_INIT && op != OP_DESTROY) {
+				userdata->timeouts[op] = (uint64_t) timeout * 1000000;
+			}
+		}
+
+		if (fuse->options.timeout_reply != NULL) {
+			if (strcmp(fuse->options.timeout_reply, "eio") == 0) {
+				userdata->timeout_errno = EIO;
+			} else if (strcmp(fuse->options.timeout_reply, "etimedout") != 0) {
+				fprintf(stderr, "fuse: invalid timeout reply %s\n", fuse->options.timeout_reply);
+			}
+
+			free(fuse->options.timeout_reply);
+			fuse->options.timeout_reply = NULL;
+		}
+
+		if (fuse->options.rx_cpus != NULL) {
+			if (!Thread::ParseCpus(fuse->options.rx_cpus, &fuse->rx_cpus)) {
+				fprintf(stderr, "fuse: invalid cpu list rx_cpus=%s\n", fuse->options.rx_cpus);
+				fuse->rx_cpus.count = 0;
+			} else {
+				// This thread only waits, but keep it with the receivers
+				Thread::Pin(pthread_self(), &fuse->rx_cpus);
+			}
+
+			free(fuse->options.rx_cpus);
+			fuse->options.rx_cpus = NULL;
+		}
+
+		if (fuse->options.loop_cpus != NULL) {
+			Thread::CpuSet loop_cpus;
+			int err = 0;
+
+			if (!Thread::ParseCpus(fuse->options.loop_cpus, &loop_cpus)) {
+				fprintf(stderr, "fuse: invalid cpu list loop_cpus=%s\n", fuse->options.loop_cpus);
+			} else if ((err = Thread::Pin(fuse->loop_thread, &loop_cpus)) != 0) {
+				fprintf(stderr, "fuse: unable to pin the event loop: %s\n", strerror(err));
+			}
+
+			free(fuse->options.loop_cpus);
+			fuse->options.loop_cpus = NULL;
+		}
+
+		fuse->native_library = NULL;
+
+		if (fuse->options.native != NULL) {
+			userdata->native = NativeHandler::Load(fuse->options.native, fuse->mountpoint, &fuse->native_library);
+
+			if (userdata->native == NULL) {
+				fuse_unmount(fuse->mountpoint, fuse->channel);
+				fuse->channel = NULL;
+				fuse_opt_free_args(fuse->fargs);
+				fuse->native_failed = fuse->options.native;
+				fuse->options.native = NULL;
+				uv_async_send(&baton->s_async);
+				return;
+			}
+
+			userdata->native_ops = userdata->native->Operations();
+
+			// Read-ahead never learns about changes made natively
+			if (userdata->readahead->max_window > 0 &&
+			    (userdata->native_ops & (NATIVE_OP(OP_WRITE) | NATIVE_OP(OP_SETATTR))) != 0) {
+				fprintf(stderr, "fuse: readahead disabled, the native handler answers write or setattr\n");
+				userdata->readahead->max_window = 0;
+			}
+		}
 
 		fuse->session = fuse_lowlevel_new(fuse->fargs, operations, sizeof(*operations), userdata);
 
 		if (fuse->session == NULL) {
 			fuse_unmount(fuse->mountpoint, fuse->channel);
+			fuse->channel = NULL;
 			fuse_opt_free_args(fuse->fargs);
 			FUSEJS_THROW_EXCEPTION("Error creating fuse session: ", strerror(errno));
 			return;
 		}
 
 		// ret = fuse_set_signal_handlers(fuse->session);
-		if (fuse_set_signal_handlers(fuse->session) == -1) {
+		if (__sync_bool_compare_and_swap(&signal_session, NULL, fuse->session) &&
+		    fuse_set_signal_handlers(fuse->session) == -1) {
+			signal_session = NULL;
 			fuse_session_destroy(fuse->session);
+			fuse->session = NULL;
 			fuse_unmount(fuse->mountpoint, fuse->channel);
+			fuse->channel = NULL;
 			fuse_opt_free_args(fuse->fargs);
 			FUSEJS_THROW_EXCEPTION("Error setting fuse signal handlers: ", strerror(errno));
 			return;
 		}
 
 		fuse_session_add_chan(fuse->session, fuse->channel);
-		fuse_session_loop(fuse->session);
+		admission->session = fuse->session;
+
+		unsigned int nthreads = fuse->multithreaded ? fuse->options.threads : 1;
+		if (nthreads < 1) {
+			nthreads = 1;
+		} else if (nthreads > FUSEJS_MAX_THREADS) {
+			nthreads = FUSEJS_MAX_THREADS;
+		}
+
+		// Every receive thread reads from /dev/fuse and pushes into the
+		// request queue on its own, wait until the first one gives up
+		// (unmount or signal) and then stop the rest.
+		Worker *workers = new Worker[nthreads];
+		bool cloning = fuse->options.clone_fd;
+		uv_sem_init(&fuse->finished, 0);
+
+		for (unsigned int i = 0; i < nthreads; i++) {
+			workers[i].fuse = fuse;
+			workers[i].index = i;
+			workers[i].channel = fuse->channel;
+
+			// The first thread keeps the descriptor fuse_mount opened
+			if (cloning && i > 0) {
+				workers[i].channel = Channel::Clone(fuse->channel, fuse->session);
+
+				if (workers[i].channel == NULL) {
+					fprintf(stderr, "fuse: unable to clone /dev/fuse (%s), sharing one descriptor\n", strerror(errno));
+					workers[i].channel = fuse->channel;
+					cloning = false;
+				}
+			}
+		}
+
+		// Started once cloning is over, the first thread shares its
+		// descriptor with the others when a clone failed
+		for (unsigned int i = 0; i < nthreads; i++) {
+			workers[i].exclusive = i > 0 ? workers[i].channel != fuse->channel : cloning;
+			uv_thread_create(&workers[i].thread, Fuse::ReceiveWorker, &workers[i]);
+		}
+
+		uv_sem_wait(&fuse->finished);
+		fuse_session_exit(fuse->session);
+
+		for (unsigned int i = 0; i < nthreads; i++) {
+			pthread_cancel(workers[i].thread);
+		}
+
+		for (unsigned int i = 0; i < nthreads; i++) {
+			uv_thread_join(&workers[i].thread);
+
+			if (workers[i].channel != fuse->channel) {
+				fuse_chan_destroy(workers[i].channel);
+			}
+		}
+
+		delete[] workers;
+		uv_sem_destroy(&fuse->finished);
 
 		// Continues executing if user unmounts the fs
-		fuse_remove_signal_handlers(fuse->session);
+		if (signal_session == fuse->session) {
+			fuse_remove_signal_handlers(fuse->session);
+			signal_session = NULL;
+		}
 
 		// fuse_unmount(fuse->mountpoint, fuse->channel);
 		fuse_session_remove_chan(fuse->channel);
 		fuse_session_destroy(fuse->session);
 		fuse_unmount(fuse->mountpoint, fuse->channel);
 		fuse_opt_free_args(fuse->fargs);
+
+		// No FUSE thread is left that could call into the plugin
+		userdata->native_ops = 0;
+		NativeHandler::Unload(userdata->native, fuse->native_library);
+		userdata->native = NULL;
+		fuse->native_library = NULL;
+
+		if (fuse->options.native != NULL) {
+			free(fuse->options.native);
+			fuse->options.native = NULL;
+		}
+	}
+
+	void Fuse::ReceiveWorker(void *args) {
+		Worker *worker = reinterpret_cast<Worker *>(args);
+		Fuse *fuse = worker->fuse;
+
+		struct fuse_session *se = fuse->session;
+		struct fuse_chan *ch = worker->channel;
+		ReceivePool *pool = fuse->userdata->buffers;
+		size_t bufsize = fuse_chan_bufsize(ch);
+		char *buf = pool->Get(bufsize);
+
+		char name[16];
+		snprintf(name, sizeof(name), "fuse-rx-%u", worker->index);
+		Thread::SetName(name);
+
+		// With a descriptor per thread give every thread a core of its own
+		if (fuse->rx_cpus.count > 0) {
+			int err = worker->exclusive ? Thread::Pin(pthread_self(), &fuse->rx_cpus, worker->index)
+			                            : Thread::Pin(pthread_self(), &fuse->rx_cpus);
+
+			if (err != 0) {
+				fprintf(stderr, "fuse: unable to pin %s: %s\n", name, strerror(err));
+			}
+		}
+
+		if (buf == NULL) {
+			fprintf(stderr, "fuse: failed to allocate read buffer\n");
+			uv_sem_post(&fuse->finished);
+			return;
+		}
+
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		pthread_cleanup_push(Fuse::ReceiveCleanup, &buf);
+
+		while (!fuse_session_exited(se)) {
+			struct fuse_chan *tmpch = ch;
+			struct fuse_buf fbuf;
+
+			memset(&fbuf, 0, sizeof(fbuf));
+			fbuf.mem = buf;
+			fbuf.size = bufsize;
+
+			// Only allow cancellation while blocked on the kernel,
+			// never in the middle of handing a request over.
+			pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+			int res = fuse_session_receive_buf(se, &fbuf, &tmpch);
+			pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+			if (res == -EINTR) {
+				continue;
+			}
+
+			if (res <= 0) {
+				break;
+			}
+
+			ReceivePool::Processing(buf, bufsize);
+			fuse_session_process_buf(se, &fbuf, tmpch);
+
+			// A write kept the buffer, its data goes to javascript as is
+			if (ReceivePool::Claimed()) {
+				buf = pool->Get(bufsize);
+
+				if (buf == NULL) {
+					fprintf(stderr, "fuse: failed to allocate read buffer\n");
+					break;
+				}
+			}
+		}
+
+		pthread_cleanup_pop(1);
+		uv_sem_post(&fuse->finished);
+	}
+
+	void Fuse::ReceiveCleanup(void *args) {
+		char *buf = *reinterpret_cast<char **>(args);
+
+		ReceivePool::Processing(NULL, 0);
+
+		if (buf != NULL) {
+			ReceivePool::Put(buf);
+		}
 	}
 
 	void Fuse::AsyncCallback(uv_async_t *handle, int status) {
 		HandleScope scope;
-		
-		ThreadFunData *argument = reinterpret_cast<ThreadFunData *>(handle->data);
 
-		Proxy::Call(argument->op, CI, handle->data);
+		FileSystem::Userdata *userdata = reinterpret_cast<FileSystem::Userdata *>(handle->data);
+		Fuse *fuse = reinterpret_cast<Fuse *>(userdata->fuse);
+		ThreadFunData *argument;
+
+		if (fuse->native_failed != NULL) {
+			Local<Value> argv[1] = { String::New(fuse->native_failed) };
+			free(fuse->native_failed);
+			fuse->native_failed = NULL;
+			Event::Emit(fuse, "error", 1, argv);
+		}
+
+		unsigned int weights[PRIORITY_COUNT] = {
+			fuse->options.weight_meta,
+			fuse->options.weight_default,
+			fuse->options.weight_data
+		};
+
+		// uv_async_send coalesces, so drain everything the FUSE thread
+		// has pushed since the last wakeup, but give the rest of the
+		// loop a chance once the batch budget is spent.
+		// A zero budget means no limit, for either of them
+		unsigned int max = fuse->options.batch_max;
+		uint64_t budget = (uint64_t) fuse->options.batch_time * 1000;
+		uint64_t deadline = uv_hrtime() + budget;
+		unsigned int handled = 0;
+		bool exhausted = false;
+		bool pending = true;
+
+		// Weighted round robin: every round each class may dispatch
+		// up to its weight before the next class gets a turn.
+		while (pending && !exhausted) {
+			pending = false;
+
+			for (int priority = 0; priority < PRIORITY_COUNT && !exhausted; priority++) {
+				RequestQueue *queue = userdata->queues[priority];
+				unsigned int quantum = weights[priority] > 0 ? weights[priority] : 1;
+
+				for (unsigned int i = 0; i < quantum; i++) {
+					argument = reinterpret_cast<ThreadFunData *>(queue->Pop());
+					if (argument == NULL) {
+						break;
+					}
+
+					pending = true;
+					userdata->stats[priority].dispatched++;
+					Proxy::Call(fuse, argument->op, argument);
+					handled++;
+
+					if ((max > 0 && handled >= max) || (budget > 0 && uv_hrtime() >= deadline)) {
+						exhausted = true;
+						break;
+					}
+				}
+			}
+		}
+
+		// Interrupts are few and cheap, let handlers know right away
+		fuse_req_t interrupted;
+		while ((interrupted = reinterpret_cast<fuse_req_t>(userdata->interrupts->Pop())) != NULL) {
+			Reply::Abort(userdata, interrupted);
+		}
+
+		// Read-ahead windows failed where javascript could not run
+		userdata->readahead->Flush();
+
+		if (exhausted) {
+			exhausted = false;
+			for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+				if (userdata->queues[priority]->Size() > 0) {
+					exhausted = true;
+				}
+			}
+		}
+
+		if (exhausted) {
+			// Pick up the remainder on the next loop iteration
+			uv_async_send(handle);
+		}
+
+		if (handled > 0) {
+			Local<Value> argv[2] = { Integer::NewFromUnsigned(handled), Local<Value>::New(Boolean::New(exhausted)) };
+			Event::Emit(fuse, "drain", 2, argv);
+		}
 	}
 
 	Handle<Value> Fuse::Mount(const Arguments &args) {
@@ -138,14 +662,49 @@ namespace NodeFuse {
 
 		struct fuse_args fargs = FUSE_ARGS_INIT(0, NULL);
 
+		if (ObjectWrap::Unwrap<Fuse>(args.This())->userdata != NULL) {
+			return ThrowException(Exception::Error(
+			                          String::New("Already mounted, create a new Fuse instance for every mount")));
+		}
+
 		Baton *baton = new Baton();
 
-		baton->s_async.data = baton;
+		baton->userdata = new FileSystem::Userdata();
+		baton->userdata->fuse = NULL;
+		baton->userdata->async = &baton->s_async;
+		for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+			baton->userdata->queues[priority] = new RequestQueue(FUSEJS_QUEUE_SIZE);
+			baton->userdata->stats[priority].enqueued = 0;
+			baton->userdata->stats[priority].dispatched = 0;
+		}
+		baton->userdata->requests = new RequestSlab(FUSEJS_REQUEST_SLAB_SIZE);
+		baton->userdata->buffers = new ReceivePool(FUSEJS_RECEIVE_POOL_SIZE);
+		baton->userdata->readahead = new ReadAhead(baton->userdata);
+		baton->userdata->native = NULL;
+		baton->userdata->native_ops = 0;
+		baton->userdata->admission = new Admission();
+		baton->userdata->interrupts = new RequestQueue(FUSEJS_INTERRUPT_QUEUE_SIZE);
+		baton->userdata->live = NULL;
+		baton->userdata->interrupts_received = 0;
+		baton->userdata->interrupts_replied = 0;
+		for (int op = 0; op < OP_COUNT; op++) {
+			baton->userdata->timeouts[op] = 0;
+		}
+		baton->userdata->timeout_errno = ETIMEDOUT;
+		baton->userdata->deadlines = new TimingWheel((uint64_t) FUSEJS_DEADLINE_RESOLUTION * 1000000, FUSEJS_DEADLINE_SLOTS);
+		baton->userdata->deadline_timer = &baton->s_deadlines;
+		baton->userdata->timeouts_expired = 0;
+		baton->userdata->timeouts_late = 0;
+		baton->userdata->timeouts_abandoned = 0;
+
+		baton->s_async.data = baton->userdata;
+		baton->s_deadlines.data = baton->userdata;
 		baton->argc = options->Length();
 		baton->fargs = fargs;
 		baton->currentInstance = Persistent<Object>::New(args.This());
 
-		CI = Persistent<Object>::New(args.This());
+		ObjectWrap::Unwrap<Fuse>(args.This())->userdata = baton->userdata;
+		ObjectWrap::Unwrap<Fuse>(args.This())->loop_thread = pthread_self();
 
 		if (baton->argc < 3) {
 			options->Set(Integer::New(2), String::New("--help"));
@@ -165,7 +724,12 @@ namespace NodeFuse {
 		Local<Value> argv[2] = { currentInstance, options };
 		baton->fsobj = Persistent<Object>::New(filesystem->NewInstance(2, argv));
 
+		Fuse *fuse = ObjectWrap::Unwrap<Fuse>(currentInstance);
+		Proxy::CacheHandlers(fuse, baton->fsobj);
+		baton->userdata->splice = fuse->splice[OP_WRITE];
+
 		uv_async_init(uv_default_loop(), &baton->s_async, Fuse::AsyncCallback);
+		uv_timer_init(uv_default_loop(), &baton->s_deadlines);
 		// uv_async_send(&baton->s_async);
 
 		uv_thread_create(&baton->worker_thread, Fuse::AsyncWorker, baton);
@@ -177,6 +741,89 @@ namespace NodeFuse {
 		return scope.Close(Undefined());
 	}
 
+	Handle<Value> Fuse::Refresh(const Arguments &args) {
+		HandleScope scope;
+
+		Fuse *fuse = ObjectWrap::Unwrap<Fuse>(args.This());
+
+		if (!fuse->fsobj.IsEmpty()) {
+			Proxy::CacheHandlers(fuse, fuse->fsobj);
+		}
+
+		return scope.Close(Undefined());
+	}
+
+	Handle<Value> Fuse::Stats(const Arguments &args) {
+		HandleScope scope;
+
+		Fuse *fuse = ObjectWrap::Unwrap<Fuse>(args.This());
+		Local<Object> stats = Object::New();
+
+		if (fuse->userdata == NULL) {
+			return scope.Close(stats);
+		}
+
+		FileSystem::Userdata *userdata = fuse->userdata;
+		Persistent<String> *names[PRIORITY_COUNT] = { &meta_sym, &default_sym, &data_sym };
+		Local<Object> queues = Object::New();
+
+		for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+			Local<Object> queue = Object::New();
+			queue->Set(depth_sym, Number::New(userdata->queues[priority]->Size()));
+			queue->Set(enqueued_sym, Number::New(userdata->stats[priority].enqueued));
+			queue->Set(dispatched_sym, Number::New(userdata->stats[priority].dispatched));
+			queues->Set(*names[priority], queue);
+		}
+
+		stats->Set(queues_sym, queues);
+
+		Admission *admission = userdata->admission;
+		Local<Object> admissionObj = Object::New();
+		admissionObj->Set(inflight_sym, Number::New(admission->inflight));
+		admissionObj->Set(throttled_sym, Number::New(admission->throttled));
+		admissionObj->Set(rejected_sym, Number::New(admission->rejected));
+		stats->Set(admission_sym, admissionObj);
+
+		Local<Object> interrupts = Object::New();
+		interrupts->Set(received_sym, Number::New(userdata->interrupts_received));
+		interrupts->Set(replied_sym, Number::New(userdata->interrupts_replied));
+		stats->Set(interrupts_sym, interrupts);
+
+		Local<Object> timeouts = Object::New();
+		timeouts->Set(expired_sym, Number::New(userdata->timeouts_expired));
+		timeouts->Set(late_sym, Number::New(userdata->timeouts_late));
+		timeouts->Set(abandoned_sym, Number::New(userdata->timeouts_abandoned));
+		stats->Set(timeouts_sym, timeouts);
+
+		RequestSlab *slab = userdata->requests;
+		Local<Object> descriptors = Object::New();
+		descriptors->Set(capacity_sym, Number::New(slab->capacity));
+		descriptors->Set(used_sym, Number::New(slab->in_use));
+		descriptors->Set(peak_sym, Number::New(slab->peak));
+		descriptors->Set(overflows_sym, Number::New(slab->overflows));
+		stats->Set(descriptors_sym, descriptors);
+
+		Local<Object> namesObj = Object::New();
+		namesObj->Set(hits_sym, Number::New(NameCache::hits));
+		namesObj->Set(misses_sym, Number::New(NameCache::misses));
+		stats->Set(names_sym, namesObj);
+
+		Local<Object> buffers = Object::New();
+		buffers->Set(allocated_sym, Number::New(userdata->buffers->allocated));
+		buffers->Set(claimed_sym, Number::New(userdata->buffers->claimed));
+		stats->Set(buffers_sym, buffers);
+
+		ReadAhead *readahead = userdata->readahead;
+		Local<Object> readaheadObj = Object::New();
+		readaheadObj->Set(hits_sym, Number::New(readahead->hits));
+		readaheadObj->Set(misses_sym, Number::New(readahead->misses));
+		readaheadObj->Set(prefetched_sym, Number::New(readahead->prefetched));
+		readaheadObj->Set(wasted_sym, Number::New(readahead->wasted));
+		stats->Set(readahead_sym, readaheadObj);
+
+		return scope.Close(stats);
+	}
+
 	// Handle<Value> Fuse::Unmount(const Arguments& args) {
 	//     HandleScope scope;
 
@@ -7,31 +7,72 @@
 #include <stdio.h>
 #include <string>
 #include <cstdlib>
+#include <pthread.h>
 
 #include "node_fuse.h"
 #include "filesystem.h"
 #include "proxy.h"
+#include "channel.h"
+#include "thread.h"
 
 namespace NodeFuse {
 	class Fuse : public ObjectWrap {
 		public:
 			static void Initialize(Handle<Object> target);
-			struct ThreadFunData {
-				void **args;
-				const char *op;
+
+			// Mount options handled by fusejs itself, they are
+			// removed from the argument list before it reaches libfuse.
+			struct Options {
+				unsigned int threads;
+				unsigned int batch_max;
+				unsigned int batch_time;
+				char *native;
+				unsigned int weight_meta;
+				unsigned int weight_default;
+				unsigned int weight_data;
+				unsigned int max_inflight;
+				unsigned int op_max_inflight[OP_COUNT];
+				char *throttle;
+				unsigned int timeout;
+				unsigned int op_timeout[OP_COUNT];
+				char *timeout_reply;
+				int clone_fd;
+				char *rx_cpus;
+				char *loop_cpus;
+				unsigned int readahead;
 			};
 
 			Persistent<Object> fsobj;
 
+			// Filesystem handlers resolved at mount time, indexed by
+			// Operation. Empty when the filesystem does not implement it.
+			Persistent<Function> handlers[OP_COUNT];
+			int arity[OP_COUNT];
+			// False for handlers whose context property is false,
+			// they get undefined in place of the request context
+			bool context[OP_COUNT];
+			// True for handlers whose copy property is set, they get
+			// data of their own rather than a view of the receive buffer
+			bool copy[OP_COUNT];
+			// True for handlers whose splice property is set, write
+			// then gets a WriteBuffer to forward instead of a Buffer
+			bool splice[OP_COUNT];
+			bool request_ids;
+			Persistent<Function> notice;
+
 			Fuse();
 			virtual ~Fuse();
 
 		protected:
 			static Handle<Value> New(const Arguments &args);
 			static Handle<Value> Mount(const Arguments &args);
+			static Handle<Value> Refresh(const Arguments &args);
+			static Handle<Value> Stats(const Arguments &args);
 
 			static void AsyncWorker(void *args);
 			static void AsyncCallback(uv_async_t *handle, int status);
+			static void ReceiveWorker(void *args);
+			static void ReceiveCleanup(void *args);
 
 			// static Handle<Value> Unmount(const Arguments& args);
 
@@ -42,16 +83,31 @@ namespace NodeFuse {
 			struct fuse_args *fargs;
 			struct fuse_chan *channel;
 			struct fuse_session *session;
+			Options options;
+			uv_sem_t finished;
+			void *native_library;
+			// Path of a native handler that failed to load, reported
+			// from the event loop since the mount thread cannot
+			char *native_failed;
+			FileSystem::Userdata *userdata;
+			pthread_t loop_thread;
+			Thread::CpuSet rx_cpus;
 			static Persistent<FunctionTemplate> constructor_template;
 
-			struct Userdata {
-				void *fuse;
-				uv_async_t *async;
+			struct Worker {
+				Fuse *fuse;
+				uv_thread_t thread;
+				unsigned int index;
+				struct fuse_chan *channel;
+				// Reads from a descriptor no other thread uses
+				bool exclusive;
 			};
 
 			struct Baton {
 				uv_async_t s_async;
+				uv_timer_t s_deadlines;
 				uv_thread_t worker_thread;
+				FileSystem::Userdata *userdata;
 				Persistent<Object> currentInstance;
 				Persistent<Object> fsobj;
 				Fuse *fuse;
@@ -61,13 +117,26 @@ namespace NodeFuse {
 	};
 } // namespace NodeFuse
 
+// Receive threads used when the filesystem is not mounted with -s
+#define FUSEJS_DEFAULT_THREADS 4
+#define FUSEJS_MAX_THREADS 64
+
+// Upper bounds for a single drain of the request queue, in requests
+// and in microseconds. Anything left over waits for the next tick.
+#define FUSEJS_DEFAULT_BATCH_MAX 256
+#define FUSEJS_DEFAULT_BATCH_TIME 2000
+
+#define FUSEJS_OPT(templ, member)                                   \
+    { templ, offsetof(NodeFuse::Fuse::Options, member), 1 }
+
 #define FUSE_SYM(name)                                              \
     static Persistent<String> name##_sym = NODE_PSYMBOL(#name);
 
 #define BIND_OPERATION(name)                                        \
-    if (op_name == #name) {                                         \
-    	Proxy::name(CI, pArgument);                                 \
-    }
+    Proxy::name,
+
+#define BIND_DISPATCH(op)                                           \
+    Proxy::Dispatch<op>,
 
 
 #endif  // SRC_BINDINGS_H
\ No newline at end of file
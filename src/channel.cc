@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include "channel.h"
+
+#ifndef FUSE_DEV_IOC_CLONE
+#define FUSE_DEV_IOC_CLONE _IOR(229, 0, uint32_t)
+#endif
+
+// sizeof(struct fuse_in_header), the kernel never sends less
+#define FUSE_IN_HEADER_SIZE 40
+
+namespace NodeFuse {
+	static struct fuse_chan_ops clone_ops = {};
+
+	struct fuse_chan *Channel::Clone(struct fuse_chan *master,
+	                                 struct fuse_session *se) {
+#ifdef __linux__
+		int fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+
+		if (fd == -1) {
+			return NULL;
+		}
+
+		uint32_t masterfd = fuse_chan_fd(master);
+
+		if (ioctl(fd, FUSE_DEV_IOC_CLONE, &masterfd) == -1) {
+			close(fd);
+			return NULL;
+		}
+
+		clone_ops.receive = Channel::Receive;
+		clone_ops.send = Channel::Send;
+		clone_ops.destroy = Channel::Destroy;
+
+		struct fuse_chan *ch = fuse_chan_new(&clone_ops, fd, fuse_chan_bufsize(master), se);
+
+		if (ch == NULL) {
+			close(fd);
+		}
+
+		return ch;
+#else
+		return NULL;
+#endif
+	}
+
+	// Same as the kernel channel libfuse uses for the mount descriptor
+	int Channel::Receive(struct fuse_chan **chp,
+	                     char *buf,
+	                     size_t size) {
+		struct fuse_chan *ch = *chp;
+		struct fuse_session *se = (struct fuse_session *) fuse_chan_data(ch);
+		ssize_t res;
+		int err;
+
+		do {
+			res = read(fuse_chan_fd(ch), buf, size);
+			err = errno;
+		} while (res == -1 && err == ENOENT && !fuse_session_exited(se));
+
+		if (fuse_session_exited(se)) {
+			return 0;
+		}
+
+		if (res == -1) {
+			// Filesystem unmounted
+			if (err == ENODEV) {
+				fuse_session_exit(se);
+				return 0;
+			}
+
+			if (err != EINTR && err != EAGAIN) {
+				perror("fuse: reading device");
+			}
+
+			return -err;
+		}
+
+		if ((size_t) res < FUSE_IN_HEADER_SIZE) {
+			fprintf(stderr, "fuse: short read on fuse device\n");
+			return -EIO;
+		}
+
+		return res;
+	}
+
+	int Channel::Send(struct fuse_chan *ch,
+	                  const struct iovec iov[],
+	                  size_t count) {
+		if (iov == NULL) {
+			return 0;
+		}
+
+		ssize_t res = writev(fuse_chan_fd(ch), iov, count);
+		int err = errno;
+
+		if (res == -1) {
+			struct fuse_session *se = (struct fuse_session *) fuse_chan_data(ch);
+
+			// ENOENT means the request was interrupted meanwhile
+			if (!fuse_session_exited(se) && err != ENOENT) {
+				perror("fuse: writing device");
+			}
+
+			return -err;
+		}
+
+		return 0;
+	}
+
+	void Channel::Destroy(struct fuse_chan *ch) {
+		close(fuse_chan_fd(ch));
+	}
+} // namespace NodeFuse
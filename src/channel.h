@@ -0,0 +1,28 @@
+#ifndef SRC_CHANNEL_H_
+#define SRC_CHANNEL_H_
+#include <fuse_lowlevel.h>
+
+namespace NodeFuse {
+	// Extra channels on clones of the /dev/fuse descriptor, so every
+	// receive thread reads from and replies on its own file descriptor
+	// instead of all of them contending on the one fuse_mount opened.
+	// Requests remember the channel they came from, their replies go
+	// back on the same clone.
+	class Channel {
+		public:
+			// Returns NULL when the kernel cannot clone the device
+			static struct fuse_chan *Clone(struct fuse_chan *master,
+			                               struct fuse_session *se);
+
+		private:
+			static int Receive(struct fuse_chan **chp,
+			                   char *buf,
+			                   size_t size);
+			static int Send(struct fuse_chan *ch,
+			                const struct iovec iov[],
+			                size_t count);
+			static void Destroy(struct fuse_chan *ch);
+	};
+} // namespace NodeFuse
+
+#endif // SRC_CHANNEL_H
@@ -3,8 +3,6 @@
 
 namespace NodeFuse {
 
-	static Persistent<String> notice_sym = NODE_PSYMBOL("notice");
-
 	void Event::Emit(Fuse *fuse,
 	                 const char *type,
 	                 const int argc,
@@ -12,8 +10,11 @@ namespace NodeFuse {
 
 		HandleScope scope;
 
-		Local<Value> vnotice = fuse->fsobj->Get(notice_sym);
-		Local<Function> notice = Local<Function>::Cast(vnotice);
+		if (fuse->notice.IsEmpty()) {
+			return;
+		}
+
+		Local<Function> notice = Local<Function>::New(fuse->notice);
 		Local<String> msg_type = String::New(type);
 		Local<Array> msg_argv = Array::New(argc);
 
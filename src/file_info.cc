@@ -2,12 +2,26 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
+#include <map>
 #include "file_info.h"
 
 namespace NodeFuse {
 	Persistent<FunctionTemplate> FileInfo::constructor_template;
 
+	// Internal fields, the handle and flags are only
+	// used until the object is materialized
+	enum {
+		FIELD_WRAPPED = 0,
+		FIELD_FH,
+		FIELD_FLAGS,
+		FIELD_COUNT
+	};
+
+	static std::map<int, Persistent<Object> > decoded_flags;
+
 	static Persistent<String> flags_sym         = NODE_PSYMBOL("flags");
+	static Persistent<String> flags_raw_sym     = NODE_PSYMBOL("flagsRaw");
 	static Persistent<String> writepage_sym     = NODE_PSYMBOL("writepage");
 	static Persistent<String> direct_io_sym     = NODE_PSYMBOL("direct_io");
 	static Persistent<String> keep_cache_sym    = NODE_PSYMBOL("keep_cache");
@@ -44,9 +58,10 @@ namespace NodeFuse {
 		Local<FunctionTemplate> t = FunctionTemplate::New();
 		Local<ObjectTemplate> object_tmpl = t->InstanceTemplate();
 
-		object_tmpl->SetInternalFieldCount(1);
+		object_tmpl->SetInternalFieldCount(FIELD_COUNT);
 
 		object_tmpl->SetAccessor(flags_sym, FileInfo::GetFlags);
+		object_tmpl->SetAccessor(flags_raw_sym, FileInfo::GetFlagsRaw);
 		object_tmpl->SetAccessor(writepage_sym, FileInfo::GetWritePage);
 		object_tmpl->SetAccessor(direct_io_sym, FileInfo::GetDirectIO, FileInfo::SetDirectIO);
 		object_tmpl->SetAccessor(keep_cache_sym, FileInfo::GetKeepCache, FileInfo::SetKeepCache);
@@ -62,125 +77,128 @@ namespace NodeFuse {
 	FileInfo::FileInfo() : ObjectWrap() {}
 	FileInfo::~FileInfo() {}
 
-	Handle<Value> FileInfo::GetFlags(Local<String> property, const AccessorInfo &info) {
+	Local<Object> FileInfo::NewLazy(uint64_t fh, int flags) {
 		HandleScope scope;
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
-		Local<Object> flagsObj = Object::New();
+		Local<Object> object = constructor_template->GetFunction()->NewInstance();
 
-		//Initializes object
-		flagsObj->Set(rdonly_sym, False());
-		flagsObj->Set(wronly_sym, False());
-		flagsObj->Set(rdwr_sym, False());
-		flagsObj->Set(nonblock_sym, False());
-		flagsObj->Set(append_sym, False());
-		flagsObj->Set(creat_sym, False());
-		flagsObj->Set(trunc_sym, False());
-		flagsObj->Set(excl_sym, False());
-#ifdef O_SHLOCK
-		flagsObj->Set(shlock_sym, False());
-#endif
-#ifdef O_EXLOCK
-		flagsObj->Set(exlock_sym, False());
-#endif
-		flagsObj->Set(nofollow_sym, False());
-#ifdef O_SYMLINK
-		flagsObj->Set(symlink_sym, False());
-#endif
-#ifdef O_EVTONLY
-		flagsObj->Set(evtonly_sym, False());
-#endif
-		/*
-		   O_RDONLY        open for reading only
-		   O_WRONLY        open for writing only
-		   O_RDWR          open for reading and writing
-		   O_NONBLOCK      do not block on open or for data to become available
-		   O_APPEND        append on each write
-		   O_CREAT         create file if it does not exist
-		   O_TRUNC         truncate size to 0
-		   O_EXCL          error if O_CREAT and the file exists
-		   O_SHLOCK        atomically obtain a shared lock
-		   O_EXLOCK        atomically obtain an exclusive lock
-		   O_NOFOLLOW      do not follow symlinks
-		   O_SYMLINK       allow open of symlinks
-		   O_EVTONLY       descriptor requested for event notifications only
-		*/
-
-		int flags = fileInfo->fi->flags;
-		if (flags & O_RDONLY) {
-			flagsObj->Set(rdonly_sym, True());
-		}
+		object->SetPointerInInternalField(FIELD_WRAPPED, NULL);
+		object->SetInternalField(FIELD_FH, Number::New(fh));
+		object->SetInternalField(FIELD_FLAGS, Integer::New(flags));
 
-		if (flags & O_WRONLY) {
-			flagsObj->Set(wronly_sym, True());
-		}
+		return scope.Close(object);
+	}
 
-		if (flags & O_RDWR) {
-			flagsObj->Set(rdwr_sym, True());
-		}
+	FileInfo *FileInfo::Materialize(Handle<Object> object) {
+		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(object);
 
-		if (flags & O_NONBLOCK) {
-			flagsObj->Set(nonblock_sym, True());
+		if (fileInfo != NULL) {
+			return fileInfo;
 		}
 
-		if (flags & O_APPEND) {
-			flagsObj->Set(append_sym, True());
-		}
+		fileInfo = new FileInfo();
+		memset(&fileInfo->copy, 0, sizeof(fileInfo->copy));
+		fileInfo->copy.fh = object->GetInternalField(FIELD_FH)->IntegerValue();
+		fileInfo->copy.flags = object->GetInternalField(FIELD_FLAGS)->Int32Value();
+		fileInfo->fi = &fileInfo->copy;
+		fileInfo->Wrap(object);
 
-		if (flags & O_CREAT) {
-			flagsObj->Set(creat_sym, True());
-		}
+		return fileInfo;
+	}
 
-		if (flags & O_TRUNC) {
-			flagsObj->Set(trunc_sym, True());
-		}
+	int FileInfo::FlagsOf(Handle<Object> object) {
+		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(object);
 
-		if (flags & O_EXCL) {
-			flagsObj->Set(excl_sym, True());
+		if (fileInfo == NULL) {
+			return object->GetInternalField(FIELD_FLAGS)->Int32Value();
 		}
 
+		return fileInfo->fi->flags;
+	}
+
+	/*
+	   O_RDONLY        open for reading only
+	   O_WRONLY        open for writing only
+	   O_RDWR          open for reading and writing
+	   O_NONBLOCK      do not block on open or for data to become available
+	   O_APPEND        append on each write
+	   O_CREAT         create file if it does not exist
+	   O_TRUNC         truncate size to 0
+	   O_EXCL          error if O_CREAT and the file exists
+	   O_SHLOCK        atomically obtain a shared lock
+	   O_EXLOCK        atomically obtain an exclusive lock
+	   O_NOFOLLOW      do not follow symlinks
+	   O_SYMLINK       allow open of symlinks
+	   O_EVTONLY       descriptor requested for event notifications only
+	*/
+	static Local<Object> DecodeFlags(int flags) {
+		HandleScope scope;
+		Local<Object> flagsObj = Object::New();
+		int access = flags & O_ACCMODE;
+
+		flagsObj->Set(rdonly_sym, Boolean::New(access == O_RDONLY), ReadOnly);
+		flagsObj->Set(wronly_sym, Boolean::New(access == O_WRONLY), ReadOnly);
+		flagsObj->Set(rdwr_sym, Boolean::New(access == O_RDWR), ReadOnly);
+		flagsObj->Set(nonblock_sym, Boolean::New(flags & O_NONBLOCK), ReadOnly);
+		flagsObj->Set(append_sym, Boolean::New(flags & O_APPEND), ReadOnly);
+		flagsObj->Set(creat_sym, Boolean::New(flags & O_CREAT), ReadOnly);
+		flagsObj->Set(trunc_sym, Boolean::New(flags & O_TRUNC), ReadOnly);
+		flagsObj->Set(excl_sym, Boolean::New(flags & O_EXCL), ReadOnly);
 #ifdef O_SHLOCK
-		if (flags & O_SHLOCK) {
-			flagsObj->Set(shlock_sym, True());
-		}
+		flagsObj->Set(shlock_sym, Boolean::New(flags & O_SHLOCK), ReadOnly);
 #endif
-
 #ifdef O_EXLOCK
-		if (flags & O_EXLOCK) {
-			flagsObj->Set(exlock_sym, True());
-		}
+		flagsObj->Set(exlock_sym, Boolean::New(flags & O_EXLOCK), ReadOnly);
+#endif
+		flagsObj->Set(nofollow_sym, Boolean::New(flags & O_NOFOLLOW), ReadOnly);
+#ifdef O_SYMLINK
+		flagsObj->Set(symlink_sym, Boolean::New(flags & O_SYMLINK), ReadOnly);
+#endif
+#ifdef O_EVTONLY
+		flagsObj->Set(evtonly_sym, Boolean::New(flags & O_EVTONLY), ReadOnly);
 #endif
 
-		if (flags & O_NOFOLLOW) {
-			flagsObj->Set(nofollow_sym, True());
-		}
+		return scope.Close(flagsObj);
+	}
 
-#ifdef O_SYMLINK
-		if (flags & O_SYMLINK) {
-			flagsObj->Set(symlink_sym, True());
+	// A handle keeps its flags for as long as it is open, and handles
+	// mostly share a handful of values, so decoded objects are reused.
+	// They are read-only for that reason.
+	Handle<Value> FileInfo::GetFlags(Local<String> property, const AccessorInfo &info) {
+		HandleScope scope;
+		int flags = FlagsOf(info.This());
+
+		std::map<int, Persistent<Object> >::iterator cached = decoded_flags.find(flags);
+		if (cached != decoded_flags.end()) {
+			return scope.Close(cached->second);
 		}
-#endif
 
-#ifdef O_EVTONLY
-		if (flags & O_EVTONLY) {
-			flagsObj->Set(evtonly_sym, True());
+		Local<Object> flagsObj = DecodeFlags(flags);
+
+		if (decoded_flags.size() < FUSEJS_FLAGS_CACHE_SIZE) {
+			decoded_flags[flags] = Persistent<Object>::New(flagsObj);
 		}
-#endif
 
 		return scope.Close(flagsObj);
 	}
 
+	Handle<Value> FileInfo::GetFlagsRaw(Local<String> property, const AccessorInfo &info) {
+		HandleScope scope;
+
+		return scope.Close(Integer::New(FlagsOf(info.This())));
+	}
+
 	Handle<Value> FileInfo::GetWritePage(Local<String> property, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 		return fileInfo->fi->writepage ? True() : False();
 	}
 
 	Handle<Value> FileInfo::GetDirectIO(Local<String> property, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 		return fileInfo->fi->direct_io ? True() : False();
 	}
 
 	void FileInfo::SetDirectIO(Local<String> property, Local<Value> value, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 
 		if (!value->IsBoolean()) {
 			FUSEJS_THROW_EXCEPTION("Invalid value type: ", "a Boolean was expected");
@@ -190,12 +208,12 @@ namespace NodeFuse {
 	}
 
 	Handle<Value> FileInfo::GetKeepCache(Local<String> property, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 		return fileInfo->fi->keep_cache ? True() : False();
 	}
 
 	void FileInfo::SetKeepCache(Local<String> property, Local<Value> value, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 
 		if (!value->IsBoolean()) {
 			FUSEJS_THROW_EXCEPTION("Invalid value type: ", "a Boolean was expected");
@@ -205,12 +223,12 @@ namespace NodeFuse {
 	}
 
 	Handle<Value> FileInfo::GetFlush(Local<String> property, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 		return fileInfo->fi->flush ? True() : False();
 	}
 
 	Handle<Value> FileInfo::GetNonSeekable(Local<String> property, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 #if FUSE_USE_VERSION > 27
 		return fileInfo->fi->nonseekable ? True() : False();
 #else
@@ -219,7 +237,7 @@ namespace NodeFuse {
 	}
 
 	void FileInfo::SetNonSeekable(Local<String> property, Local<Value> value, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 
 		if (!value->IsBoolean()) {
 			FUSEJS_THROW_EXCEPTION("Invalid value type: ", "a Boolean was expected");
@@ -230,7 +248,7 @@ namespace NodeFuse {
 	}
 
 	void FileInfo::SetFileHandle(Local<String> property, Local<Value> value, const AccessorInfo &info) {
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 
 		if (!value->IsNumber()) {
 			FUSEJS_THROW_EXCEPTION("Invalid value type: ", "a Number was expected");
@@ -243,12 +261,16 @@ namespace NodeFuse {
 		HandleScope scope;
 		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
 
-		return scope.Close(Integer::New(fileInfo->fi->fh));
+		if (fileInfo == NULL) {
+			return scope.Close(info.This()->GetInternalField(FIELD_FH));
+		}
+
+		return scope.Close(Number::New(fileInfo->fi->fh));
 	}
 
 	Handle<Value> FileInfo::GetLockOwner(Local<String> property, const AccessorInfo &info) {
 		HandleScope scope;
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(info.This());
+		FileInfo *fileInfo = FileInfo::Materialize(info.This());
 
 		return scope.Close(Integer::New(fileInfo->fi->lock_owner));
 	}
@@ -1,8 +1,12 @@
 // Copyright 2012, Camilo Aguilar. Cloudescape, LLC.
 #ifndef SRC_FILE_INFO_H_
 #define SRC_FILE_INFO_H_
+#include <stdint.h>
 #include "node_fuse.h"
 
+// Decoded flags objects kept for reuse, one per distinct flags value
+#define FUSEJS_FLAGS_CACHE_SIZE 64
+
 namespace NodeFuse {
 	class FileInfo : public ObjectWrap {
 			friend class FileSystem;
@@ -19,11 +23,18 @@ namespace NodeFuse {
 				return constructor_template->HasInstance(object);
 			}
 
+			// A file info that only knows its handle and open flags. The
+			// native side is created the first time anything else is used.
+			static Local<Object> NewLazy(uint64_t fh, int flags);
+			static FileInfo *Materialize(Handle<Object> object);
+
 			FileInfo();
 			virtual ~FileInfo();
 
 		protected:
+			static int FlagsOf(Handle<Object> object);
 			static Handle<Value> GetFlags(Local<String> property, const AccessorInfo &info);
+			static Handle<Value> GetFlagsRaw(Local<String> property, const AccessorInfo &info);
 			static Handle<Value> GetWritePage(Local<String> property, const AccessorInfo &info);
 			static Handle<Value> GetDirectIO(Local<String> property, const AccessorInfo &info);
 			static void SetDirectIO(Local<String> property, Local<Value> value, const AccessorInfo &info);
@@ -38,6 +49,8 @@ namespace NodeFuse {
 
 		private:
 			struct fuse_file_info *fi;
+			// Own copy, the request descriptor fi came from is reused
+			struct fuse_file_info copy;
 			static Persistent<FunctionTemplate> constructor_template;
 	};
 } //namespace NodeFuse
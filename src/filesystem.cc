@@ -4,557 +4,235 @@
 #include "bindings.h"
 #include "node_buffer.h"
 #include "event.h"
+#include "op_traits.h"
 
 namespace NodeFuse {
 	static struct fuse_lowlevel_ops fuse_ops = {};
 
-	void FileSystem::Initialize() {
-		fuse_ops.init       		= FileSystem::Init;
-		fuse_ops.destroy    		= FileSystem::Destroy;
-		fuse_ops.lookup     		= FileSystem::Lookup;
-		fuse_ops.forget     		= FileSystem::Forget;
-		fuse_ops.forget_multi     	= FileSystem::ForgetMulti;
-		fuse_ops.getattr    		= FileSystem::GetAttr;
-		fuse_ops.setattr    		= FileSystem::SetAttr;
-		fuse_ops.readlink   		= FileSystem::ReadLink;
-		fuse_ops.mknod      		= FileSystem::MkNod;
-		fuse_ops.mkdir      		= FileSystem::MkDir;
-		fuse_ops.unlink     		= FileSystem::Unlink;
-		fuse_ops.rmdir      		= FileSystem::RmDir;
-		fuse_ops.symlink    		= FileSystem::SymLink;
-		fuse_ops.rename     		= FileSystem::Rename;
-		fuse_ops.link       		= FileSystem::Link;
-		fuse_ops.open       		= FileSystem::Open;
-		fuse_ops.read       		= FileSystem::Read;
-		fuse_ops.write      		= FileSystem::Write;
-		fuse_ops.flush      		= FileSystem::Flush;
-		fuse_ops.release    		= FileSystem::Release;
-		fuse_ops.fsync      		= FileSystem::FSync;
-		fuse_ops.opendir    		= FileSystem::OpenDir;
-		fuse_ops.readdir    		= FileSystem::ReadDir;
-		fuse_ops.releasedir 		= FileSystem::ReleaseDir;
-		fuse_ops.fsyncdir   		= FileSystem::FSyncDir;
-		fuse_ops.statfs     		= FileSystem::StatFs;
-		fuse_ops.setxattr   		= FileSystem::SetXAttr;
-		fuse_ops.getxattr   		= FileSystem::GetXAttr;
-		fuse_ops.listxattr  		= FileSystem::ListXAttr;
-		fuse_ops.removexattr 		= FileSystem::RemoveXAttr;
-		fuse_ops.access     		= FileSystem::Access;
-		fuse_ops.create     		= FileSystem::Create;
-		fuse_ops.getlk      		= FileSystem::GetLock;
-		fuse_ops.setlk      		= FileSystem::SetLock;
-		fuse_ops.bmap       		= FileSystem::BMap;
-	}
-
-	void FileSystem::Proxy(void *pUserdata, void *pArgs, const char *pName) {
-		// fprintf(stderr, "--> %s\n", pName);
-
-		Userdata *_userdata = reinterpret_cast<Userdata *>(pUserdata);
-
-		while (_userdata->async->pending == 1) {
-			usleep(100);
-		}
-
-		ThreadFunData *data = new ThreadFunData();
-
-		data->op = pName;
-		data->args = (void **)pArgs;
-		_userdata->async->data = data;
-
-		uv_async_send(_userdata->async);
-	}
-
-	void FileSystem::Init(void *userdata,
-	                      struct fuse_conn_info *conn) {
-
-		void **args = new void *[1];
-		args[0] = (void *)conn;
-
-		FileSystem::Proxy(userdata, args, "Init");
-	}
-
-	void FileSystem::Destroy(void *userdata) {
-		void **args = new void *[0];
-		FileSystem::Proxy(userdata, args, "Destroy");
-	}
-
-	void FileSystem::Lookup(fuse_req_t req,
-	                        fuse_ino_t parent,
-	                        const char *name) {
-
-		int _len = strlen(name);
-		char *_name = new char[_len + 1];
-		_name[_len] = 0;
-		strcpy(_name, name);
-
-		void **args = new void *[3];
-
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)_name;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Lookup");
-	}
-
-	void FileSystem::Forget(fuse_req_t req,
-	                        fuse_ino_t ino,
-	                        unsigned long nlookup) {
-
-		// fuse_reply_none(req);
-	}
-
-	void FileSystem::ForgetMulti(fuse_req_t req,
-	                             size_t count,
-	                             struct fuse_forget_data *forgets) {
-
-		for (size_t i = 0; i < count; i++)
-			FileSystem::Forget(req, forgets[i].ino, forgets[i].nlookup);
-
-		fuse_reply_none(req);
-	}
-
-	void FileSystem::GetAttr(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct fuse_file_info *fi) {
-
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "GetAttr");
-	}
-
-	void FileSystem::SetAttr(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct stat *attr,
-	                         int to_set,
-	                         struct fuse_file_info *fi) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)attr;
-		args[3] = (void *)to_set;
-		args[4] = (void *)fi;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "SetAttr");
-	}
-
-	void FileSystem::ReadLink(fuse_req_t req,
-	                          fuse_ino_t ino) {
-
-		void **args = new void *[2];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "ReadLink");
-	}
-
-	void FileSystem::MkNod(fuse_req_t req,
-	                       fuse_ino_t parent,
-	                       const char *name,
-	                       mode_t mode,
-	                       dev_t rdev) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-		args[3] = (void *)mode;
-		args[4] = (void *)rdev;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "MkNod");
-	}
-
-	void FileSystem::MkDir(fuse_req_t req,
-	                       fuse_ino_t parent,
-	                       const char *name,
-	                       mode_t mode) {
-
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-		args[3] = (void *)mode;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "MkDir");
+	static inline FileSystem::Userdata *UserdataOf(fuse_req_t req) {
+		return reinterpret_cast<FileSystem::Userdata *>(fuse_req_userdata(req));
 	}
 
-	void FileSystem::Unlink(fuse_req_t req,
-	                        fuse_ino_t parent,
-	                        const char *name) {
-
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Unlink");
-	}
-
-	void FileSystem::RmDir(fuse_req_t req,
-	                       fuse_ino_t parent,
-	                       const char *name) {
-
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "RmDir");
-	}
-
-	void FileSystem::SymLink(fuse_req_t req,
-	                         const char *link,
-	                         fuse_ino_t parent,
-	                         const char *name) {
-
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)link;
-		args[2] = (void *)parent;
-		args[3] = (void *)name;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "SymLink");
-	}
-
-	void FileSystem::Rename(fuse_req_t req,
-	                        fuse_ino_t parent,
-	                        const char *name,
-	                        fuse_ino_t newparent,
-	                        const char *newname) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-		args[3] = (void *)newparent;
-		args[4] = (void *)newname;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Rename");
+	static inline bool NativeClaims(FileSystem::Userdata *userdata, int op) {
+		return (userdata->native_ops & NATIVE_OP(op)) != 0;
 	}
 
-	void FileSystem::Link(fuse_req_t req,
-	                      fuse_ino_t ino,
-	                      fuse_ino_t newparent,
-	                      const char *newname) {
+	static inline ThreadFunData *Describe(FileSystem::Userdata *userdata, fuse_req_t req) {
+		ThreadFunData *data = userdata->requests->Acquire();
+		data->req = req;
 
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)newparent;
-		args[3] = (void *)newname;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Link");
+		return data;
 	}
 
-	void FileSystem::Open(fuse_req_t req,
-	                      fuse_ino_t ino,
-	                      struct fuse_file_info *fi) {
+	// Generated libfuse callbacks, one per operation and arity. The
+	// argument types are deduced from the fuse_lowlevel_ops member each
+	// is assigned to; OpTraits<Op> says what to do with them.
+	template <int Op, class A1>
+	static void Receive(fuse_req_t req, A1 a1) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1)) {
+			return;
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Open");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::Read(fuse_req_t req,
-	                      fuse_ino_t ino,
-	                      size_t size_,
-	                      off_t off,
-	                      struct fuse_file_info *fi) {
-
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)size_;
-		args[3] = (void *)off;
-		args[4] = (void *)fi;
+	template <int Op, class A1, class A2>
+	static void Receive(fuse_req_t req, A1 a1, A2 a2) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1, a2)) {
+			return;
+		}
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Read");
-	}
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1, a2);
 
-	void FileSystem::Write(fuse_req_t req,
-	                       fuse_ino_t ino,
-	                       const char *buf,
-	                       size_t size,
-	                       off_t off,
-	                       struct fuse_file_info *fi) {
-
-		void **args = new void *[6];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)buf;
-		args[3] = (void *)size;
-		args[4] = (void *)off;
-		args[5] = (void *)fi;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Write");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::Flush(fuse_req_t req,
-	                       fuse_ino_t ino,
-	                       struct fuse_file_info *fi) {
+	template <int Op, class A1, class A2, class A3>
+	static void Receive(fuse_req_t req, A1 a1, A2 a2, A3 a3) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1, a2, a3)) {
+			return;
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1, a2, a3);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Flush");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::Release(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct fuse_file_info *fi) {
+	template <int Op, class A1, class A2, class A3, class A4>
+	static void Receive(fuse_req_t req, A1 a1, A2 a2, A3 a3, A4 a4) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1, a2, a3, a4)) {
+			return;
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1, a2, a3, a4);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Release");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::FSync(fuse_req_t req,
-	                       fuse_ino_t ino,
-	                       int datasync_,
-	                       struct fuse_file_info *fi) {
+	template <int Op, class A1, class A2, class A3, class A4, class A5>
+	static void Receive(fuse_req_t req, A1 a1, A2 a2, A3 a3, A4 a4, A5 a5) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1, a2, a3, a4, a5)) {
+			return;
+		}
 
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)datasync_;
-		args[3] = (void *)fi;
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1, a2, a3, a4, a5);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "FSync");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::OpenDir(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct fuse_file_info *fi) {
+	template <int Op, class A1, class A2, class A3, class A4, class A5, class A6>
+	static void Receive(fuse_req_t req, A1 a1, A2 a2, A3 a3, A4 a4, A5 a5, A6 a6) {
+		FileSystem::Userdata *userdata = UserdataOf(req);
+		if (NativeClaims(userdata, Op) && OpTraits<Op>::Native(userdata->native, req, a1, a2, a3, a4, a5, a6)) {
+			return;
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
+		ThreadFunData *data = Describe(userdata, req);
+		OpTraits<Op>::Capture(data, *RequestOf<Op>(data), a1, a2, a3, a4, a5, a6);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "OpenDir");
+		FileSystem::Proxy(userdata, data, Op, OpTraits<Op>::priority);
 	}
 
-	void FileSystem::ReadDir(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         size_t size_,
-	                         off_t off,
-	                         struct fuse_file_info *fi) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)size_;
-		args[3] = (void *)off;
-		args[4] = (void *)fi;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "ReadDir");
-	}
+	void FileSystem::Initialize() {
+		fuse_ops.init         = FileSystem::Init;
+		fuse_ops.destroy      = FileSystem::Destroy;
+		fuse_ops.lookup       = &Receive<OP_LOOKUP>;
+		fuse_ops.forget       = FileSystem::Forget;
+		fuse_ops.forget_multi = FileSystem::ForgetMulti;
+		fuse_ops.getattr      = &Receive<OP_GETATTR>;
+		fuse_ops.setattr      = &Receive<OP_SETATTR>;
+		fuse_ops.readlink     = &Receive<OP_READLINK>;
+		fuse_ops.mknod        = &Receive<OP_MKNOD>;
+		fuse_ops.mkdir        = &Receive<OP_MKDIR>;
+		fuse_ops.unlink       = &Receive<OP_UNLINK>;
+		fuse_ops.rmdir        = &Receive<OP_RMDIR>;
+		fuse_ops.symlink      = &Receive<OP_SYMLINK>;
+		fuse_ops.rename       = &Receive<OP_RENAME>;
+		fuse_ops.link         = &Receive<OP_LINK>;
+		fuse_ops.open         = &Receive<OP_OPEN>;
+		fuse_ops.read         = &Receive<OP_READ>;
+		fuse_ops.write_buf    = &Receive<OP_WRITE>;
+		fuse_ops.flush        = &Receive<OP_FLUSH>;
+		fuse_ops.release      = &Receive<OP_RELEASE>;
+		fuse_ops.fsync        = &Receive<OP_FSYNC>;
+		fuse_ops.opendir      = &Receive<OP_OPENDIR>;
+		fuse_ops.readdir      = &Receive<OP_READDIR>;
+		fuse_ops.releasedir   = &Receive<OP_RELEASEDIR>;
+		fuse_ops.fsyncdir     = &Receive<OP_FSYNCDIR>;
+		fuse_ops.statfs       = &Receive<OP_STATFS>;
+		fuse_ops.setxattr     = &Receive<OP_SETXATTR>;
+		fuse_ops.getxattr     = &Receive<OP_GETXATTR>;
+		fuse_ops.listxattr    = &Receive<OP_LISTXATTR>;
+		fuse_ops.removexattr  = &Receive<OP_REMOVEXATTR>;
+		fuse_ops.access       = &Receive<OP_ACCESS>;
+		fuse_ops.create       = &Receive<OP_CREATE>;
+		fuse_ops.getlk        = &Receive<OP_GETLK>;
+		fuse_ops.setlk        = &Receive<OP_SETLK>;
+		fuse_ops.bmap         = &Receive<OP_BMAP>;
+	}
+
+	void FileSystem::Proxy(Userdata *_userdata, ThreadFunData *data, int op, int priority) {
+		// fprintf(stderr, "--> %d\n", op);
+
+		// Init and destroy have no request to answer
+		if (op != OP_INIT && op != OP_DESTROY && !_userdata->admission->Acquire(op)) {
+			int error = _userdata->admission->reject_errno;
+			fuse_reply_err(data->req, error != 0 ? error : ENOTCONN);
+			_userdata->requests->Release(data);
+			return;
+		}
 
-	void FileSystem::ReleaseDir(fuse_req_t req,
-	                            fuse_ino_t ino,
-	                            struct fuse_file_info *fi) {
+		if (op != OP_INIT && op != OP_DESTROY) {
+			fuse_req_interrupt_func(data->req, FileSystem::Interrupt, _userdata);
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
+		data->op = op;
+		data->received = _userdata->timeouts[op] > 0 ? uv_hrtime() : 0;
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "ReleaseDir");
-	}
+		RequestQueue *queue = _userdata->queues[priority];
 
-	void FileSystem::FSyncDir(fuse_req_t req,
-	                          fuse_ino_t ino,
-	                          int datasync_,
-	                          struct fuse_file_info *fi) {
+		__sync_fetch_and_add(&_userdata->stats[priority].enqueued, 1);
 
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)datasync_;
-		args[3] = (void *)fi;
+		// The event loop is behind, ring the doorbell again and
+		// stop pulling requests from the kernel until it catches up.
+		while (!queue->Push(data)) {
+			uv_async_send(_userdata->async);
+			usleep(50);
+		}
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "FSyncDir");
+		uv_async_send(_userdata->async);
 	}
 
-	void FileSystem::StatFs(fuse_req_t req,
-	                        fuse_ino_t ino) {
+	// Called by libfuse on a FUSE thread when the kernel interrupts
+	// a request. The request may be answered by the event loop at any
+	// moment, so only its address is handed over; the event loop
+	// looks it up between its live replies before touching it.
+	void FileSystem::Interrupt(fuse_req_t req, void *data) {
+		Userdata *_userdata = reinterpret_cast<Userdata *>(data);
 
-		void **args = new void *[2];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
+		__sync_fetch_and_add(&_userdata->interrupts_received, 1);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "StatFs");
+		if (_userdata->interrupts->Push(req)) {
+			uv_async_send(_userdata->async);
+		}
 	}
 
-	void FileSystem::SetXAttr(fuse_req_t req,
-	                          fuse_ino_t ino,
-	                          const char *name_,
-	                          const char *value_,
-	                          size_t size_,
-#ifdef __APPLE__
-	                          int flags_,
-	                          uint32_t position_) {
-#else
-	                          int flags_) {
-#endif
-
-#ifdef __APPLE__
-		void **args = new void *[6];
-#else
-		void **args = new void *[5];
-#endif
-
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)name_;
-		args[3] = (void *)value_;
-		args[4] = (void *)size_;
-
-#ifdef __APPLE__
-		args[5] = (void *)flags_;
-		args[6] = (void *)position_;
-#else
-		args[5] = (void *)flags_;
-#endif
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "SetXAttr");
-	}
+	void FileSystem::Init(void *userdata,
+	                      struct fuse_conn_info *conn) {
 
-	void FileSystem::GetXAttr(fuse_req_t req,
-	                          fuse_ino_t ino,
-	                          const char *name_,
-	                          size_t size_
-#ifdef __APPLE__
-	                          , uint32_t position_) {
-#else
-	                         ) {
-#endif
-
-#ifdef __APPLE__
-		void **args = new void *[5];
-#else
-		void **args = new void *[4];
-#endif
-
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)name_;
-		args[3] = (void *)size_;
-
-#ifdef __APPLE__
-		args[4] = (void *)position_;
-#else
-#endif
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "GetXAttr");
-	}
+		Userdata *_userdata = reinterpret_cast<Userdata *>(userdata);
 
-	void FileSystem::ListXAttr(fuse_req_t req,
-	                           fuse_ino_t ino,
-	                           size_t size_) {
+		// libfuse looks at want as soon as we return, the javascript
+		// init handler runs later. Only fd replies are spliced to the
+		// device, so that is always worth having.
+		conn->want |= conn->capable & FUSE_CAP_SPLICE_WRITE;
+		if (_userdata->splice) {
+			conn->want |= conn->capable & FUSE_CAP_SPLICE_READ;
+		}
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)size_;
+		ThreadFunData *data = _userdata->requests->Acquire();
+		data->req = NULL;
+		RequestOf<OP_INIT>(data)->conn = conn;
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "ListXAttr");
+		FileSystem::Proxy(_userdata, data, OP_INIT, PRIORITY_DEFAULT);
 	}
 
-	void FileSystem::RemoveXAttr(fuse_req_t req,
-	                             fuse_ino_t ino,
-	                             const char *name_) {
+	void FileSystem::Destroy(void *userdata) {
+		Userdata *_userdata = reinterpret_cast<Userdata *>(userdata);
 
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)name_;
+		ThreadFunData *data = _userdata->requests->Acquire();
+		data->req = NULL;
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "RemoveXAttr");
+		FileSystem::Proxy(_userdata, data, OP_DESTROY, PRIORITY_DEFAULT);
 	}
 
-	void FileSystem::Access(fuse_req_t req,
+	void FileSystem::Forget(fuse_req_t req,
 	                        fuse_ino_t ino,
-	                        int mask_) {
-
-		void **args = new void *[3];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)mask_;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Access");
-	}
-
-	void FileSystem::Create(fuse_req_t req,
-	                        fuse_ino_t parent,
-	                        const char *name,
-	                        mode_t mode,
-	                        struct fuse_file_info *fi) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)parent;
-		args[2] = (void *)name;
-		args[3] = (void *)mode;
-		args[4] = (void *)fi;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "Create");
-	}
-
-	void FileSystem::GetLock(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct fuse_file_info *fi,
-	                         struct flock *lock) {
-
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
-		args[3] = (void *)lock;
-
-		FileSystem::Proxy(fuse_req_userdata(req), args, "GetLock");
-	}
-
-	void FileSystem::SetLock(fuse_req_t req,
-	                         fuse_ino_t ino,
-	                         struct fuse_file_info *fi,
-	                         struct flock *lock,
-	                         int sleep_) {
-
-		void **args = new void *[5];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)fi;
-		args[3] = (void *)lock;
-		args[4] = (void *)sleep_;
+	                        unsigned long nlookup) {
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "SetLock");
+		// fuse_reply_none(req);
 	}
 
-	void FileSystem::BMap(fuse_req_t req,
-	                      fuse_ino_t ino,
-	                      size_t blocksize_,
-	                      uint64_t idx) {
+	void FileSystem::ForgetMulti(fuse_req_t req,
+	                             size_t count,
+	                             struct fuse_forget_data *forgets) {
 
-		void **args = new void *[4];
-		args[0] = (void *)req;
-		args[1] = (void *)ino;
-		args[2] = (void *)blocksize_;
-		args[3] = (void *)idx;
+		for (size_t i = 0; i < count; i++)
+			FileSystem::Forget(req, forgets[i].ino, forgets[i].nlookup);
 
-		FileSystem::Proxy(fuse_req_userdata(req), args, "BMap");
+		fuse_reply_none(req);
 	}
 
 	struct fuse_lowlevel_ops *FileSystem::GetOperations() {
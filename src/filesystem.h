@@ -2,8 +2,44 @@
 #define SRC_FILESYSTEM_H_
 #include <unistd.h>
 #include "node_fuse.h"
+#include "request_queue.h"
+#include "native_handler.h"
+#include "admission.h"
+#include "timing_wheel.h"
+#include "request_slab.h"
+#include "receive_pool.h"
+
+// Number of requests of each priority class that can be waiting for
+// the event loop before the FUSE thread stops reading from the kernel.
+#define FUSEJS_QUEUE_SIZE 1024
+
+// Interrupt notifications waiting for the event loop, extra ones are
+// dropped but the request still reads as aborted when it replies.
+#define FUSEJS_INTERRUPT_QUEUE_SIZE 256
+
+// Default share of each drain round given to every priority class
+#define FUSEJS_DEFAULT_WEIGHT_META 8
+#define FUSEJS_DEFAULT_WEIGHT_DEFAULT 4
+#define FUSEJS_DEFAULT_WEIGHT_DATA 1
+
+// Deadlines are checked every FUSEJS_DEADLINE_RESOLUTION milliseconds,
+// a wheel turn covers FUSEJS_DEADLINE_SLOTS of them.
+#define FUSEJS_DEADLINE_RESOLUTION 10
+#define FUSEJS_DEADLINE_SLOTS 1024
 
 namespace NodeFuse {
+	class Reply;
+	class ReadAhead;
+
+	// Requests are queued per class so interactive metadata lookups
+	// do not wait behind a long stream of reads and writes.
+	enum Priority {
+		PRIORITY_META = 0,
+		PRIORITY_DEFAULT,
+		PRIORITY_DATA,
+		PRIORITY_COUNT
+	};
+
 	class FileSystem {
 		public:
 			FileSystem();
@@ -15,154 +51,50 @@ namespace NodeFuse {
 			static void Init(void *userdata,
 			                 struct fuse_conn_info *conn);
 			static void Destroy(void *userdata);
-			static void Lookup(fuse_req_t req,
-			                   fuse_ino_t parent,
-			                   const char *name);
 			static void Forget(fuse_req_t req,
 			                   fuse_ino_t ino,
 			                   unsigned long nlookup);
 			static void ForgetMulti(fuse_req_t req,
 			                        size_t count,
 			                        struct fuse_forget_data *forgets);
-			static void GetAttr(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct fuse_file_info *fi);
-			static void SetAttr(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct stat *attr,
-			                    int to_set,
-			                    struct fuse_file_info *fi);
-			static void ReadLink(fuse_req_t req, fuse_ino_t ino);
-			static void MkNod(fuse_req_t req,
-			                  fuse_ino_t parent,
-			                  const char *name,
-			                  mode_t mode,
-			                  dev_t rdev);
-			static void MkDir(fuse_req_t req,
-			                  fuse_ino_t parent,
-			                  const char *name,
-			                  mode_t mode);
-			static void Unlink(fuse_req_t req,
-			                   fuse_ino_t parent,
-			                   const char *name);
-			static void RmDir(fuse_req_t req,
-			                  fuse_ino_t parent,
-			                  const char *name);
-			static void SymLink(fuse_req_t req,
-			                    const char *link,
-			                    fuse_ino_t parent,
-			                    const char *name);
-			static void Rename(fuse_req_t req,
-			                   fuse_ino_t parent,
-			                   const char *name,
-			                   fuse_ino_t newparent,
-			                   const char *newname);
-			static void Link(fuse_req_t req,
-			                 fuse_ino_t ino,
-			                 fuse_ino_t newparent,
-			                 const char *newname);
-			static void Open(fuse_req_t req,
-			                 fuse_ino_t ino,
-			                 struct fuse_file_info *fi);
-			static void Read(fuse_req_t req,
-			                 fuse_ino_t ino,
-			                 size_t size,
-			                 off_t off,
-			                 struct fuse_file_info *fi);
-			static void Write(fuse_req_t req,
-			                  fuse_ino_t ino,
-			                  const char *buf,
-			                  size_t size,
-			                  off_t off,
-			                  struct fuse_file_info *fi);
-			static void Flush(fuse_req_t req,
-			                  fuse_ino_t ino,
-			                  struct fuse_file_info *fi);
-			static void Release(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct fuse_file_info *fi);
-			static void FSync(fuse_req_t req,
-			                  fuse_ino_t ino,
-			                  int datasync,
-			                  struct fuse_file_info *fi);
-			static void OpenDir(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct fuse_file_info *fi);
-			static void ReadDir(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    size_t size,
-			                    off_t off,
-			                    struct fuse_file_info *fi);
-			static void ReleaseDir(fuse_req_t req,
-			                       fuse_ino_t ino,
-			                       struct fuse_file_info *fi);
-			static void FSyncDir(fuse_req_t req,
-			                     fuse_ino_t ino,
-			                     int datasync,
-			                     struct fuse_file_info *fi);
-			static void StatFs(fuse_req_t req, fuse_ino_t ino);
-			static void SetXAttr(fuse_req_t req,
-			                     fuse_ino_t ino,
-			                     const char *name,
-			                     const char *value,
-			                     size_t size,
-#ifdef __APPLE__
-			                     int flags,
-			                     uint32_t position);
-#else
-			                     int flags);
-
-#endif
-			static void GetXAttr(fuse_req_t req,
-			                     fuse_ino_t ino,
-			                     const char *name,
-#ifdef __APPLE__
-			                     size_t size,
-			                     uint32_t position);
-#else
-			                     size_t size);
-#endif
-			static void ListXAttr(fuse_req_t req,
-			                      fuse_ino_t ino,
-			                      size_t size);
-			static void RemoveXAttr(fuse_req_t req,
-			                        fuse_ino_t ino,
-			                        const char *name);
-			static void Access(fuse_req_t req,
-			                   fuse_ino_t ino,
-			                   int mask);
-			static void Create(fuse_req_t req,
-			                   fuse_ino_t parent,
-			                   const char *name,
-			                   mode_t mode,
-			                   struct fuse_file_info *fi);
-			static void GetLock(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct fuse_file_info *fi,
-			                    struct flock *lock);
-			static void SetLock(fuse_req_t req,
-			                    fuse_ino_t ino,
-			                    struct fuse_file_info *fi,
-			                    struct flock *lock,
-			                    int sleep);
-			static void BMap(fuse_req_t req,
-			                 fuse_ino_t ino,
-			                 size_t blocksize,
-			                 uint64_t idx);
 
-			static void Proxy(void *pUserdata,
-			                  void *pArgs,
-			                  const char *pName);
+			struct Userdata;
+			static void Proxy(Userdata *userdata,
+			                  ThreadFunData *data,
+			                  int op,
+			                  int priority);
+			static void Interrupt(fuse_req_t req, void *data);
 
-			struct ThreadFunData {
-				void **args;
-				const char *op;
+			struct QueueStats {
+				volatile uint64_t enqueued;
+				uint64_t dispatched;
 			};
 
-		private:
 			struct Userdata {
 				void *fuse;
 				uv_async_t *async;
+				RequestQueue *queues[PRIORITY_COUNT];
+				RequestSlab *requests;
+				ReceivePool *buffers;
+				// Ask the kernel to splice write data, read once at init
+				bool splice;
+				ReadAhead *readahead;
+				QueueStats stats[PRIORITY_COUNT];
+				NativeHandler *native;
+				uint64_t native_ops;
+				Admission *admission;
+				RequestQueue *interrupts;
+				Reply *live;
+				volatile uint64_t interrupts_received;
+				uint64_t interrupts_replied;
+				// Nanoseconds a request may wait for its reply, 0 for none
+				uint64_t timeouts[OP_COUNT];
+				int timeout_errno;
+				TimingWheel *deadlines;
+				uv_timer_t *deadline_timer;
+				uint64_t timeouts_expired;
+				uint64_t timeouts_late;
+				uint64_t timeouts_abandoned;
 			};
 	};
 } // namespace NodeFuse
@@ -0,0 +1,48 @@
+#include <string.h>
+#include "name_cache.h"
+
+namespace NodeFuse {
+	NameCache::Entry NameCache::entries[FUSEJS_NAME_CACHE_SIZE];
+	uint64_t NameCache::hits = 0;
+	uint64_t NameCache::misses = 0;
+
+	Local<String> NameCache::Get(const char *name) {
+		HandleScope scope;
+		size_t length = 0;
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+
+		while (name[length] != 0) {
+			hash = (hash ^ (unsigned char) name[length]) * 16777619u;
+			length++;
+		}
+
+		if (length > FUSEJS_NAME_CACHE_KEY) {
+			return scope.Close(String::New(name, length));
+		}
+
+		Entry &entry = entries[hash & (FUSEJS_NAME_CACHE_SIZE - 1)];
+
+		if (!entry.value.IsEmpty() && entry.hash == hash && entry.length == length &&
+		    memcmp(entry.name, name, length) == 0) {
+			hits++;
+			return scope.Close(entry.value);
+		}
+
+		misses++;
+
+		// Whatever was in the slot is evicted
+		Local<String> value = String::NewSymbol(name, length);
+
+		if (!entry.value.IsEmpty()) {
+			entry.value.Dispose();
+		}
+
+		entry.hash = hash;
+		entry.length = length;
+		memcpy(entry.name, name, length);
+		entry.value = Persistent<String>::New(value);
+
+		return scope.Close(value);
+	}
+} // namespace NodeFuse
@@ -0,0 +1,38 @@
+#ifndef SRC_NAME_CACHE_H_
+#define SRC_NAME_CACHE_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "node_fuse.h"
+
+// Entries in the cache, a power of two
+#define FUSEJS_NAME_CACHE_SIZE 1024
+
+// Longer names are not worth caching, they rarely come back
+#define FUSEJS_NAME_CACHE_KEY 48
+
+namespace NodeFuse {
+	// Directory entry names handed to javascript. The same few components
+	// (node_modules, .git, index.js, security.capability...) are looked up
+	// over and over, so their strings are kept as internalized symbols in
+	// a direct mapped cache and repeated names allocate nothing. Only the
+	// event loop thread uses it.
+	class NameCache {
+		public:
+			static Local<String> Get(const char *name);
+
+			static uint64_t hits;
+			static uint64_t misses;
+
+		private:
+			struct Entry {
+				uint32_t hash;
+				uint32_t length;
+				char name[FUSEJS_NAME_CACHE_KEY];
+				Persistent<String> value;
+			};
+
+			static Entry entries[FUSEJS_NAME_CACHE_SIZE];
+	};
+} // namespace NodeFuse
+
+#endif // SRC_NAME_CACHE_H
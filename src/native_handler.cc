@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <dlfcn.h>
+#include "native_handler.h"
+
+namespace NodeFuse {
+	NativeHandler *NativeHandler::Load(const char *path,
+	                                   const char *mountpoint,
+	                                   void **library) {
+		*library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+		if (*library == NULL) {
+			fprintf(stderr, "fuse: unable to load native handler: %s\n", dlerror());
+			return NULL;
+		}
+
+		NativeHandlerFactory factory = (NativeHandlerFactory) dlsym(*library, FUSEJS_NATIVE_HANDLER_SYMBOL);
+
+		if (factory == NULL) {
+			fprintf(stderr, "fuse: %s does not export %s\n", path, FUSEJS_NATIVE_HANDLER_SYMBOL);
+			dlclose(*library);
+			*library = NULL;
+			return NULL;
+		}
+
+		NativeHandler *handler = factory(mountpoint);
+
+		if (handler == NULL) {
+			fprintf(stderr, "fuse: native handler %s failed to initialize\n", path);
+			dlclose(*library);
+			*library = NULL;
+		}
+
+		return handler;
+	}
+
+	void NativeHandler::Unload(NativeHandler *handler, void *library) {
+		if (handler != NULL) {
+			delete handler;
+		}
+
+		if (library != NULL) {
+			dlclose(library);
+		}
+	}
+} // namespace NodeFuse
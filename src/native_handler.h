@@ -0,0 +1,70 @@
+#ifndef SRC_NATIVE_HANDLER_H_
+#define SRC_NATIVE_HANDLER_H_
+#include <stdint.h>
+#include <fuse_lowlevel.h>
+#include "operations.h"
+
+// Symbol a native handler plugin has to export:
+// extern "C" NodeFuse::NativeHandler *fusejs_native_handler(const char *mountpoint);
+#define FUSEJS_NATIVE_HANDLER_SYMBOL "fusejs_native_handler"
+
+#define NATIVE_OP(op) (((uint64_t) 1) << (op))
+
+namespace NodeFuse {
+	// Answers selected operations in C++, directly on the FUSE thread.
+	// Operations() tells which methods are implemented (NATIVE_OP(OP_READ) | ...).
+	// A method returns true when it replied to the request itself and
+	// false to let the request go on to the javascript filesystem.
+	class NativeHandler {
+		public:
+			NativeHandler() {}
+			virtual ~NativeHandler() {}
+
+			virtual uint64_t Operations() = 0;
+
+			virtual bool Lookup(fuse_req_t req,
+			                    fuse_ino_t parent,
+			                    const char *name) { return false; }
+			virtual bool GetAttr(fuse_req_t req,
+			                     fuse_ino_t ino,
+			                     struct fuse_file_info *fi) { return false; }
+			virtual bool ReadLink(fuse_req_t req,
+			                      fuse_ino_t ino) { return false; }
+			virtual bool Open(fuse_req_t req,
+			                  fuse_ino_t ino,
+			                  struct fuse_file_info *fi) { return false; }
+			virtual bool Read(fuse_req_t req,
+			                  fuse_ino_t ino,
+			                  size_t size,
+			                  off_t off,
+			                  struct fuse_file_info *fi) { return false; }
+			virtual bool Release(fuse_req_t req,
+			                     fuse_ino_t ino,
+			                     struct fuse_file_info *fi) { return false; }
+			virtual bool OpenDir(fuse_req_t req,
+			                     fuse_ino_t ino,
+			                     struct fuse_file_info *fi) { return false; }
+			virtual bool ReadDir(fuse_req_t req,
+			                     fuse_ino_t ino,
+			                     size_t size,
+			                     off_t off,
+			                     struct fuse_file_info *fi) { return false; }
+			virtual bool ReleaseDir(fuse_req_t req,
+			                        fuse_ino_t ino,
+			                        struct fuse_file_info *fi) { return false; }
+			virtual bool StatFs(fuse_req_t req,
+			                    fuse_ino_t ino) { return false; }
+			virtual bool Access(fuse_req_t req,
+			                    fuse_ino_t ino,
+			                    int mask) { return false; }
+
+			static NativeHandler *Load(const char *path,
+			                           const char *mountpoint,
+			                           void **library);
+			static void Unload(NativeHandler *handler, void *library);
+	};
+
+	typedef NativeHandler *(*NativeHandlerFactory)(const char *mountpoint);
+} // namespace NodeFuse
+
+#endif // SRC_NATIVE_HANDLER_H
@@ -1,6 +1,7 @@
 // Copyright 2012, Camilo Aguilar. Cloudescape, LLC.
 #include "node_fuse.h"
 #include "file_info.h"
+#include "write_buffer.h"
 #include "reply.h"
 #include "bindings.h"
 
@@ -46,14 +47,31 @@ namespace NodeFuse {
 	FUSE_SYM(start);
 	FUSE_SYM(len);
 
+	// Request contexts all share one shape, the fields are
+	// overwritten in place for every request.
+	static Persistent<ObjectTemplate> context_template;
+
+	static void InitializeRequestContext() {
+		HandleScope scope;
+		Local<ObjectTemplate> templ = ObjectTemplate::New();
+
+		templ->Set(uid_sym, Integer::New(0));
+		templ->Set(gid_sym, Integer::New(0));
+		templ->Set(pid_sym, Integer::New(0));
+
+		context_template = Persistent<ObjectTemplate>::New(templ);
+	}
+
 	void InitializeFuse(Handle<Object> target) {
 		HandleScope scope;
 
 		Fuse::Initialize(target);
 		FileSystem::Initialize();
 		Proxy::Initialize();
-		Reply::Initialize();
+		Reply::Initialize(target);
 		FileInfo::Initialize();
+		WriteBuffer::Initialize();
+		InitializeRequestContext();
 
 		target->Set(String::NewSymbol("version"),
 		            String::New(NODE_FUSE_VERSION));
@@ -177,7 +195,7 @@ namespace NodeFuse {
 
 	Handle<Value> RequestContextToObject(const struct fuse_ctx *ctx) {
 		HandleScope scope;
-		Local<Object> context = Object::New();
+		Local<Object> context = context_template->NewInstance();
 
 		context->Set(uid_sym, Integer::New(ctx->uid));
 		context->Set(gid_sym, Integer::New(ctx->gid));
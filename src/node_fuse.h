@@ -7,6 +7,7 @@
 #include <fuse_lowlevel.h>
 #include <errno.h>
 #include <string.h>
+#include "operations.h"
 
 #define NODE_FUSE_VERSION "0.0.1"
 
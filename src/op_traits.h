@@ -0,0 +1,947 @@
+#ifndef SRC_OP_TRAITS_H_
+#define SRC_OP_TRAITS_H_
+#include "node_fuse.h"
+#include "node_buffer.h"
+#include "filesystem.h"
+#include "request_slab.h"
+#include "proxy.h"
+#include "name_cache.h"
+#include "reply.h"
+#include "write_buffer.h"
+#include "splice_pipe.h"
+#include "read_ahead.h"
+
+// Everything the bindings know about an operation lives in its
+// OpTraits specialization: the typed request it is queued as, how
+// the FUSE callback arguments are captured into it, how it is handed
+// to javascript, its priority class and native handler method.
+// FileSystem::Receive and Proxy::Dispatch are generated from these at
+// compile time, so nothing is cast through void * or looked up at run
+// time on the way.
+//
+//   Request   typed arguments, kept in the descriptor payload
+//   Capture   copies the callback arguments into a Request, on the FUSE thread
+//   argc      number of javascript arguments between context and reply
+//   Marshal   converts a Request into those arguments, on the event loop
+//   Native    calls the native handler, false to go on to javascript
+//   OpenInfo  file info an open reply answers with, NULL for other ops
+//   lent      argument Marshal leaves empty for Lend to fill, -1 for none
+//   Lend      wraps data still in the receive buffer, the reply gives it back
+
+namespace NodeFuse {
+	class Fuse;
+
+	// Fails to compile when a request does not fit the descriptor payload
+	template <bool> struct PayloadFits;
+	template <> struct PayloadFits<true> {};
+
+	template <int Op> struct OpTraits;
+
+	template <int Op>
+	inline typename OpTraits<Op>::Request *RequestOf(ThreadFunData *data) {
+		(void) sizeof(PayloadFits<sizeof(typename OpTraits<Op>::Request) <= FUSEJS_REQUEST_PAYLOAD>);
+		return reinterpret_cast<typename OpTraits<Op>::Request *>(data->payload.bytes);
+	}
+
+	inline Local<Value> InodeToValue(fuse_ino_t ino) {
+		return Number::New(ino);
+	}
+
+	inline Local<Value> NameToValue(const char *name) {
+		return NameCache::Get(name);
+	}
+
+	inline Local<Value> PathToValue(const char *path) {
+		return String::New(path);
+	}
+
+	// Offsets and block indexes do not fit in an Integer
+	inline Local<Value> OffsetToValue(uint64_t offset) {
+		return Number::New(offset);
+	}
+
+	// All that reads, writes and the other operations on an open file
+	// keep of its file info, the rest is only built if a handler asks
+	struct OpenHandle {
+		uint64_t fh;
+		int flags;
+	};
+
+	inline void CaptureHandle(OpenHandle &handle, const struct fuse_file_info *fi) {
+		handle.fh = fi != NULL ? fi->fh : 0;
+		handle.flags = fi != NULL ? fi->flags : 0;
+	}
+
+	inline Local<Value> HandleToValue(Fuse *fuse, const OpenHandle &handle) {
+		return Proxy::FileHandleObject(fuse, handle.fh, handle.flags);
+	}
+
+	// Defaults an operation's traits inherit and may hide
+	struct OpDefaults {
+		template <class A1>
+		static bool Native(NativeHandler *, fuse_req_t, A1) { return false; }
+		template <class A1, class A2>
+		static bool Native(NativeHandler *, fuse_req_t, A1, A2) { return false; }
+		template <class A1, class A2, class A3>
+		static bool Native(NativeHandler *, fuse_req_t, A1, A2, A3) { return false; }
+		template <class A1, class A2, class A3, class A4>
+		static bool Native(NativeHandler *, fuse_req_t, A1, A2, A3, A4) { return false; }
+		template <class A1, class A2, class A3, class A4, class A5>
+		static bool Native(NativeHandler *, fuse_req_t, A1, A2, A3, A4, A5) { return false; }
+		template <class A1, class A2, class A3, class A4, class A5, class A6>
+		static bool Native(NativeHandler *, fuse_req_t, A1, A2, A3, A4, A5, A6) { return false; }
+
+		template <class R>
+		static struct fuse_file_info *OpenInfo(R &) { return NULL; }
+
+		static const int lent = -1;
+		template <class R>
+		static Local<Value> Lend(Fuse *, Reply *, R &) { return Local<Value>(); }
+
+		// Runs on the event loop before the handler is called, true
+		// when the request was taken care of without it
+		template <class R>
+		static bool Intercept(Fuse *, fuse_req_t, uint64_t, R &) { return false; }
+
+		// Inode whose data the request changes, read-ahead drops what
+		// it holds of it when the handler is called and when it answers
+		template <class R>
+		static fuse_ino_t Modifies(R &) { return 0; }
+
+		// Most data the request may be answered with
+		template <class R>
+		static size_t Limit(R &) { return SIZE_MAX; }
+	};
+
+	inline ReadAhead *ReadAheadOf(fuse_req_t req) {
+		return reinterpret_cast<FileSystem::Userdata *>(fuse_req_userdata(req))->readahead;
+	}
+
+	template <> struct OpTraits<OP_INIT> : OpDefaults {
+		struct Request {
+			struct fuse_conn_info *conn;
+		};
+	};
+
+	template <> struct OpTraits<OP_LOOKUP> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "lookup"; }
+
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+		}
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t parent, const char *name) {
+			return native->Lookup(req, parent, name);
+		}
+	};
+
+	template <> struct OpTraits<OP_GETATTR> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "getattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_file_info *fi) {
+			r.ino = ino;
+		}
+
+		static const int argc = 1;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+		}
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+			return native->GetAttr(req, ino, fi);
+		}
+	};
+
+	template <> struct OpTraits<OP_SETATTR> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "setattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			struct stat *attr;
+			int to_set;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct stat *attr,
+		                    int to_set, struct fuse_file_info *fi) {
+			r.ino = ino;
+			r.attr = data->CopyStat(attr);
+			r.to_set = to_set;
+		}
+
+		static fuse_ino_t Modifies(Request &r) {
+			return (r.to_set & FUSE_SET_ATTR_SIZE) ? r.ino : 0;
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Local<Value>::New(GetAttrsToBeSet(r.to_set, r.attr));
+		}
+	};
+
+	template <> struct OpTraits<OP_READLINK> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "readlink"; }
+
+		struct Request {
+			fuse_ino_t ino;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino) {
+			r.ino = ino;
+		}
+
+		static const int argc = 1;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+		}
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino) {
+			return native->ReadLink(req, ino);
+		}
+	};
+
+	template <> struct OpTraits<OP_MKNOD> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "mknod"; }
+
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+			mode_t mode;
+			dev_t rdev;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name,
+		                    mode_t mode, dev_t rdev) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+			r.mode = mode;
+			r.rdev = rdev;
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+			argv[2] = Integer::New(r.mode);
+			argv[3] = Number::New(r.rdev);
+		}
+	};
+
+	template <> struct OpTraits<OP_MKDIR> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "mkdir"; }
+
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+			mode_t mode;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name, mode_t mode) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+			r.mode = mode;
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+			argv[2] = Integer::New(r.mode);
+		}
+	};
+
+	// Unlink and rmdir only differ by name
+	struct EntryNameTraits : OpDefaults {
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+		}
+	};
+
+	template <> struct OpTraits<OP_UNLINK> : EntryNameTraits {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "unlink"; }
+	};
+
+	template <> struct OpTraits<OP_RMDIR> : EntryNameTraits {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "rmdir"; }
+	};
+
+	template <> struct OpTraits<OP_SYMLINK> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "symlink"; }
+
+		struct Request {
+			const char *link;
+			fuse_ino_t parent;
+			const char *name;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, const char *link, fuse_ino_t parent, const char *name) {
+			r.link = data->CopyName(link);
+			r.parent = parent;
+			r.name = data->CopyName(name);
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = PathToValue(r.link);
+			argv[2] = NameToValue(r.name);
+		}
+	};
+
+	template <> struct OpTraits<OP_RENAME> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "rename"; }
+
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+			fuse_ino_t newparent;
+			const char *newname;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name,
+		                    fuse_ino_t newparent, const char *newname) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+			r.newparent = newparent;
+			r.newname = data->CopyName(newname);
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+			argv[2] = InodeToValue(r.newparent);
+			argv[3] = NameToValue(r.newname);
+		}
+	};
+
+	template <> struct OpTraits<OP_LINK> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "link"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			fuse_ino_t newparent;
+			const char *newname;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, fuse_ino_t newparent, const char *newname) {
+			r.ino = ino;
+			r.newparent = newparent;
+			r.newname = data->CopyName(newname);
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = InodeToValue(r.newparent);
+			argv[2] = NameToValue(r.newname);
+		}
+	};
+
+	// Opening operations, the handler fills in the file info it replies with
+	template <int Op>
+	struct FileTraits : OpDefaults {
+		struct Request {
+			fuse_ino_t ino;
+			struct fuse_file_info *fi;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_file_info *fi) {
+			r.ino = ino;
+			r.fi = data->CopyFileInfo(fi);
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Proxy::FileInfoObject(fuse, Op, r.fi);
+		}
+	};
+
+	// Operations on an open file or directory that only pass its handle
+	template <int Op>
+	struct HandleTraits : OpDefaults {
+		struct Request {
+			fuse_ino_t ino;
+			OpenHandle handle;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_file_info *fi) {
+			r.ino = ino;
+			CaptureHandle(r.handle, fi);
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = HandleToValue(fuse, r.handle);
+		}
+	};
+
+	template <> struct OpTraits<OP_OPEN> : FileTraits<OP_OPEN> {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "open"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+			return native->Open(req, ino, fi);
+		}
+
+		static struct fuse_file_info *OpenInfo(Request &r) { return r.fi; }
+	};
+
+	// Read and readdir only differ by name
+	template <int Op>
+	struct ReadTraits : OpDefaults {
+		struct Request {
+			fuse_ino_t ino;
+			size_t size;
+			off_t off;
+			OpenHandle handle;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, size_t size,
+		                    off_t off, struct fuse_file_info *fi) {
+			r.ino = ino;
+			r.size = size;
+			r.off = off;
+			CaptureHandle(r.handle, fi);
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Integer::NewFromUnsigned(r.size);
+			argv[2] = OffsetToValue(r.off);
+			argv[3] = HandleToValue(fuse, r.handle);
+		}
+	};
+
+	template <> struct OpTraits<OP_READ> : ReadTraits<OP_READ> {
+		static const int priority = PRIORITY_DATA;
+		static const char *Name() { return "read"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, size_t size,
+		                   off_t off, struct fuse_file_info *fi) {
+			return native->Read(req, ino, size, off, fi);
+		}
+
+		static size_t Limit(Request &r) {
+			return r.size;
+		}
+
+		static bool Intercept(Fuse *fuse, fuse_req_t req, uint64_t received, Request &r) {
+			return ReadAheadOf(req)->Read(fuse, req, received, r.ino, r.handle.fh, r.handle.flags,
+			                              r.off, r.size);
+		}
+	};
+
+	template <> struct OpTraits<OP_WRITE> : OpDefaults {
+		static const int priority = PRIORITY_DATA;
+		static const char *Name() { return "write"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			const char *buf;
+			size_t size;
+			off_t off;
+			OpenHandle handle;
+			// Receive buffer buf lies in, or the pipe the data was
+			// moved to when spliced. buf is a copy when both are NULL.
+			char *block;
+			SplicePipe *pipe;
+		};
+
+		// libfuse reuses whatever the data is in once we return. Data
+		// left in the receive buffer stays there, spliced data is moved
+		// on to a pipe of our own and anything else is copied.
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_bufvec *bufv,
+		                    off_t off, struct fuse_file_info *fi) {
+			size_t size = fuse_buf_size(bufv);
+			struct fuse_buf *src = &bufv->buf[bufv->idx];
+
+			r.ino = ino;
+			r.buf = NULL;
+			r.size = size;
+			r.off = off;
+			CaptureHandle(r.handle, fi);
+
+			if (bufv->count - bufv->idx == 1 && !(src->flags & FUSE_BUF_IS_FD)) {
+				r.buf = (const char *) src->mem + bufv->off;
+				data->block = ReceivePool::Claim(r.buf, size);
+
+				// Still lent out as it is, from a buffer of the pool
+				if (data->block == NULL && (data->block = ReceivePool::Spare()) != NULL) {
+					memcpy(data->block, r.buf, size);
+					r.buf = data->block;
+				} else if (data->block == NULL) {
+					r.buf = data->Copy(r.buf, size);
+				}
+			} else {
+				data->pipe = SplicePipe::Get(size);
+				size_t moved = data->pipe != NULL ? data->pipe->Fill(bufv, size) : 0;
+
+				if (moved < size) {
+					char *mem = ReceivePool::Spare();
+					data->block = mem;
+					if (mem == NULL) {
+						mem = data->Reserve(size);
+					}
+
+					// Take back what made it into the pipe, then the rest
+					if (data->pipe != NULL) {
+						data->pipe->Drain(mem, moved);
+						SplicePipe::Put(data->pipe);
+						data->pipe = NULL;
+					}
+
+					struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size - moved);
+					dst.buf[0].mem = mem + moved;
+					fuse_buf_copy(&dst, bufv, (enum fuse_buf_copy_flags) 0);
+					r.buf = mem;
+				}
+			}
+
+			r.block = data->block;
+			r.pipe = data->pipe;
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+
+			// Left empty when Lend can hand the data over as it is
+			if (r.block == NULL && r.pipe == NULL && !fuse->splice[OP_WRITE]) {
+				argv[1] = Local<Object>::New(Buffer::New((char *) r.buf, r.size)->handle_);
+			} else if (!fuse->splice[OP_WRITE] && r.pipe != NULL) {
+				Buffer *buffer = Buffer::New(r.size);
+				r.pipe->Drain(Buffer::Data(buffer->handle_), r.size);
+				argv[1] = Local<Object>::New(buffer->handle_);
+			} else if (!fuse->splice[OP_WRITE] && fuse->copy[OP_WRITE]) {
+				argv[1] = Local<Object>::New(Buffer::New((char *) r.buf, r.size)->handle_);
+			}
+
+			argv[2] = OffsetToValue(r.off);
+			argv[3] = HandleToValue(fuse, r.handle);
+		}
+
+		static const int lent = 1;
+		static Local<Value> Lend(Fuse *fuse, Reply *reply, Request &r) {
+			if (fuse->splice[OP_WRITE]) {
+				return reply->Lend(WriteBuffer::New(r.block, r.buf, r.pipe, r.size));
+			}
+
+			return reply->Lend(r.block, r.buf, r.size);
+		}
+
+		static fuse_ino_t Modifies(Request &r) {
+			return r.ino;
+		}
+	};
+
+	template <> struct OpTraits<OP_FLUSH> : HandleTraits<OP_FLUSH> {
+		static const int priority = PRIORITY_DATA;
+		static const char *Name() { return "flush"; }
+	};
+
+	template <> struct OpTraits<OP_RELEASE> : HandleTraits<OP_RELEASE> {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "release"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+			return native->Release(req, ino, fi);
+		}
+
+		static bool Intercept(Fuse *fuse, fuse_req_t req, uint64_t received, Request &r) {
+			ReadAheadOf(req)->Close(r.ino, r.handle.fh);
+			return false;
+		}
+	};
+
+	// Fsync and fsyncdir only differ by name
+	template <int Op>
+	struct SyncTraits : OpDefaults {
+		struct Request {
+			fuse_ino_t ino;
+			int datasync;
+			OpenHandle handle;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, int datasync, struct fuse_file_info *fi) {
+			r.ino = ino;
+			r.datasync = datasync;
+			CaptureHandle(r.handle, fi);
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Local<Value>::New(Boolean::New(r.datasync != 0));
+			argv[2] = HandleToValue(fuse, r.handle);
+		}
+	};
+
+	template <> struct OpTraits<OP_FSYNC> : SyncTraits<OP_FSYNC> {
+		static const int priority = PRIORITY_DATA;
+		static const char *Name() { return "fsync"; }
+	};
+
+	template <> struct OpTraits<OP_OPENDIR> : FileTraits<OP_OPENDIR> {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "opendir"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+			return native->OpenDir(req, ino, fi);
+		}
+
+		static struct fuse_file_info *OpenInfo(Request &r) { return r.fi; }
+	};
+
+	template <> struct OpTraits<OP_READDIR> : ReadTraits<OP_READDIR> {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "readdir"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, size_t size,
+		                   off_t off, struct fuse_file_info *fi) {
+			return native->ReadDir(req, ino, size, off, fi);
+		}
+	};
+
+	template <> struct OpTraits<OP_RELEASEDIR> : HandleTraits<OP_RELEASEDIR> {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "releasedir"; }
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+			return native->ReleaseDir(req, ino, fi);
+		}
+	};
+
+	template <> struct OpTraits<OP_FSYNCDIR> : SyncTraits<OP_FSYNCDIR> {
+		static const int priority = PRIORITY_DATA;
+		static const char *Name() { return "fsyncdir"; }
+	};
+
+	template <> struct OpTraits<OP_STATFS> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "statfs"; }
+
+		struct Request {
+			fuse_ino_t ino;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino) {
+			r.ino = ino;
+		}
+
+		static const int argc = 1;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+		}
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino) {
+			return native->StatFs(req, ino);
+		}
+	};
+
+	template <> struct OpTraits<OP_SETXATTR> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "setxattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			const char *name;
+			const char *value;
+			size_t size;
+			int flags;
+#ifdef __APPLE__
+			uint32_t position;
+#endif
+		};
+
+#ifdef __APPLE__
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, const char *name,
+		                    const char *value, size_t size, int flags, uint32_t position) {
+			r.position = position;
+#else
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, const char *name,
+		                    const char *value, size_t size, int flags) {
+#endif
+			r.ino = ino;
+			r.name = data->CopyName(name);
+			r.value = data->Copy(value, size);
+			r.size = size;
+			r.flags = flags;
+		}
+
+#ifdef __APPLE__
+		static const int argc = 6;
+#else
+		static const int argc = 5;
+#endif
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = NameToValue(r.name);
+			argv[2] = String::New(r.value, r.size);
+			argv[3] = Number::New(r.size);
+			//TODO change for an object with accessors
+			argv[4] = Integer::New(r.flags);
+#ifdef __APPLE__
+			argv[5] = Integer::NewFromUnsigned(r.position);
+#endif
+		}
+	};
+
+	template <> struct OpTraits<OP_GETXATTR> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "getxattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			const char *name;
+			size_t size;
+#ifdef __APPLE__
+			uint32_t position;
+#endif
+		};
+
+#ifdef __APPLE__
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, const char *name,
+		                    size_t size, uint32_t position) {
+			r.position = position;
+#else
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, const char *name, size_t size) {
+#endif
+			r.ino = ino;
+			r.name = data->CopyName(name);
+			r.size = size;
+		}
+
+#ifdef __APPLE__
+		static const int argc = 4;
+#else
+		static const int argc = 3;
+#endif
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = NameToValue(r.name);
+			argv[2] = Number::New(r.size);
+#ifdef __APPLE__
+			argv[3] = Integer::NewFromUnsigned(r.position);
+#endif
+		}
+	};
+
+	template <> struct OpTraits<OP_LISTXATTR> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "listxattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			size_t size;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, size_t size) {
+			r.ino = ino;
+			r.size = size;
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Number::New(r.size);
+		}
+	};
+
+	template <> struct OpTraits<OP_REMOVEXATTR> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "removexattr"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			const char *name;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, const char *name) {
+			r.ino = ino;
+			r.name = data->CopyName(name);
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = NameToValue(r.name);
+		}
+	};
+
+	template <> struct OpTraits<OP_ACCESS> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "access"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			int mask;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, int mask) {
+			r.ino = ino;
+			r.mask = mask;
+		}
+
+		static const int argc = 2;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Integer::New(r.mask);
+		}
+
+		static bool Native(NativeHandler *native, fuse_req_t req, fuse_ino_t ino, int mask) {
+			return native->Access(req, ino, mask);
+		}
+	};
+
+	template <> struct OpTraits<OP_CREATE> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "create"; }
+
+		struct Request {
+			fuse_ino_t parent;
+			const char *name;
+			mode_t mode;
+			struct fuse_file_info *fi;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t parent, const char *name,
+		                    mode_t mode, struct fuse_file_info *fi) {
+			r.parent = parent;
+			r.name = data->CopyName(name);
+			r.mode = mode;
+			r.fi = data->CopyFileInfo(fi);
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.parent);
+			argv[1] = NameToValue(r.name);
+			argv[2] = Integer::New(r.mode);
+			argv[3] = Proxy::FileInfoObject(fuse, OP_CREATE, r.fi);
+		}
+
+		static struct fuse_file_info *OpenInfo(Request &r) { return r.fi; }
+	};
+
+	template <> struct OpTraits<OP_GETLK> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "getlk"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			struct fuse_file_info *fi;
+			struct flock *lock;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_file_info *fi,
+		                    struct flock *lock) {
+			r.ino = ino;
+			r.fi = data->CopyFileInfo(fi);
+			r.lock = data->CopyFlock(lock);
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Proxy::FileInfoObject(fuse, OP_GETLK, r.fi);
+			argv[2] = Local<Value>::New(FlockToObject(r.lock));
+		}
+	};
+
+	template <> struct OpTraits<OP_SETLK> : OpDefaults {
+		static const int priority = PRIORITY_DEFAULT;
+		static const char *Name() { return "setlk"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			struct fuse_file_info *fi;
+			struct flock *lock;
+			int sleep;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, struct fuse_file_info *fi,
+		                    struct flock *lock, int sleep) {
+			r.ino = ino;
+			r.fi = data->CopyFileInfo(fi);
+			r.lock = data->CopyFlock(lock);
+			r.sleep = sleep;
+		}
+
+		static const int argc = 4;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Proxy::FileInfoObject(fuse, OP_SETLK, r.fi);
+			argv[2] = Local<Value>::New(FlockToObject(r.lock));
+			argv[3] = Integer::New(r.sleep);
+		}
+	};
+
+	template <> struct OpTraits<OP_BMAP> : OpDefaults {
+		static const int priority = PRIORITY_META;
+		static const char *Name() { return "bmap"; }
+
+		struct Request {
+			fuse_ino_t ino;
+			size_t blocksize;
+			uint64_t idx;
+		};
+
+		static void Capture(ThreadFunData *data, Request &r, fuse_ino_t ino, size_t blocksize, uint64_t idx) {
+			r.ino = ino;
+			r.blocksize = blocksize;
+			r.idx = idx;
+		}
+
+		static const int argc = 3;
+		static void Marshal(Fuse *fuse, Request &r, Local<Value> *argv) {
+			argv[0] = InodeToValue(r.ino);
+			argv[1] = Integer::NewFromUnsigned(r.blocksize);
+			argv[2] = OffsetToValue(r.idx);
+		}
+	};
+} // namespace NodeFuse
+
+#endif // SRC_OP_TRAITS_H
@@ -0,0 +1,46 @@
+#ifndef SRC_OPERATIONS_H_
+#define SRC_OPERATIONS_H_
+
+namespace NodeFuse {
+	// Low level operations, used to index the dispatch
+	// table and the cached javascript handlers.
+	enum Operation {
+		OP_INIT = 0,
+		OP_DESTROY,
+		OP_LOOKUP,
+		OP_FORGET,
+		OP_GETATTR,
+		OP_SETATTR,
+		OP_READLINK,
+		OP_MKNOD,
+		OP_MKDIR,
+		OP_UNLINK,
+		OP_RMDIR,
+		OP_SYMLINK,
+		OP_RENAME,
+		OP_LINK,
+		OP_OPEN,
+		OP_READ,
+		OP_WRITE,
+		OP_FLUSH,
+		OP_RELEASE,
+		OP_FSYNC,
+		OP_OPENDIR,
+		OP_READDIR,
+		OP_RELEASEDIR,
+		OP_FSYNCDIR,
+		OP_STATFS,
+		OP_SETXATTR,
+		OP_GETXATTR,
+		OP_LISTXATTR,
+		OP_REMOVEXATTR,
+		OP_ACCESS,
+		OP_CREATE,
+		OP_GETLK,
+		OP_SETLK,
+		OP_BMAP,
+		OP_COUNT
+	};
+} // namespace NodeFuse
+
+#endif // SRC_OPERATIONS_H
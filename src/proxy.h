@@ -2,55 +2,37 @@
 #define SRC_PROXY_H_
 #include <string>
 #include "node_fuse.h"
+#include "read_ahead.h"
 
 namespace NodeFuse {
+	class Fuse;
+	class Reply;
+
 	class Proxy {
 		public:
 			Proxy();
 			virtual ~Proxy();
 
 			static void Initialize();
-			static void Call(const char *op, Persistent<Object> CI, void *pArgument);
+			static void Call(Fuse *fuse, int op, void *pArgument);
+			static void CacheHandlers(Fuse *fuse, Handle<Object> fsobj);
+			static int ReplyMode(Fuse *fuse, int op, int argc);
+			static Local<Value> ReplyObject(Reply *reply);
+			static Local<Value> FileInfoObject(Fuse *fuse, int op, struct fuse_file_info *fi);
+			static Local<Value> FileHandleObject(Fuse *fuse, uint64_t fh, int flags);
 			
-			static void Init(Persistent<Object> CI, void *pArgument);
-			static void Destroy(Persistent<Object> CI, void *pArgument);
-			static void Lookup(Persistent<Object> CI, void *pArgument);
-			static void Forget(Persistent<Object> CI, void *pArgument);
-			static void GetAttr(Persistent<Object> CI, void *pArgument);
-			static void SetAttr(Persistent<Object> CI, void *pArgument);
-			static void ReadLink(Persistent<Object> CI, void *pArgument);
-			static void MkNod(Persistent<Object> CI, void *pArgument);
-			static void MkDir(Persistent<Object> CI, void *pArgument);
-			static void Unlink(Persistent<Object> CI, void *pArgument);
-			static void RmDir(Persistent<Object> CI, void *pArgument);
-			static void SymLink(Persistent<Object> CI, void *pArgument);
-			static void Rename(Persistent<Object> CI, void *pArgument);
-			static void Link(Persistent<Object> CI, void *pArgument);
-			static void Open(Persistent<Object> CI, void *pArgument);
-			static void Read(Persistent<Object> CI, void *pArgument);
-			static void Write(Persistent<Object> CI, void *pArgument);
-			static void Flush(Persistent<Object> CI, void *pArgument);
-			static void Release(Persistent<Object> CI, void *pArgument);
-			static void FSync(Persistent<Object> CI, void *pArgument);
-			static void OpenDir(Persistent<Object> CI, void *pArgument);
-			static void ReadDir(Persistent<Object> CI, void *pArgument);
-			static void ReleaseDir(Persistent<Object> CI, void *pArgument);
-			static void FSyncDir(Persistent<Object> CI, void *pArgument);
-			static void StatFs(Persistent<Object> CI, void *pArgument);
-			static void SetXAttr(Persistent<Object> CI, void *pArgument);
-			static void GetXAttr(Persistent<Object> CI, void *pArgument);
-			static void ListXAttr(Persistent<Object> CI, void *pArgument);
-			static void RemoveXAttr(Persistent<Object> CI, void *pArgument);
-			static void Access(Persistent<Object> CI, void *pArgument);
-			static void Create(Persistent<Object> CI, void *pArgument);
-			static void GetLock(Persistent<Object> CI, void *pArgument);
-			static void SetLock(Persistent<Object> CI, void *pArgument);
-			static void BMap(Persistent<Object> CI, void *pArgument);
+			static void Init(Fuse *fuse, void *pArgument);
+			static void Destroy(Fuse *fuse, void *pArgument);
+			static void Forget(Fuse *fuse, void *pArgument);
+
+			template <int Op>
+			static void Dispatch(Fuse *fuse, void *pArgument);
 
-			struct ThreadFunData {
-				void **args;
-				const char *op;
-			};
+			// Reads the read-ahead makes itself: a window, and a read
+			// that waited on one and still is not covered
+			static void Prefetch(Fuse *fuse, ReadAhead::Window *window);
+			static void Forward(Fuse *fuse, fuse_req_t req, uint64_t received,
+			                    ReadAhead::Stream *stream, uint64_t offset, size_t size);
 
 		private:
 
@@ -66,8 +48,6 @@ namespace NodeFuse {
 	}
 
 #define FREE_ARGUMENTS()                                            \
-	void **pTmpArgs = argument->args;                               \
-	delete[] pTmpArgs;                                              \
-	delete argument;
+	argument->slab->Release(argument);
 
 #endif // SRC_PROXY_H
\ No newline at end of file
@@ -0,0 +1,461 @@
+#include <stdlib.h>
+#include <sys/uio.h>
+#include "read_ahead.h"
+#include "proxy.h"
+#include "reply.h"
+
+namespace NodeFuse {
+	ReadAhead::ReadAhead(FileSystem::Userdata *userdata) {
+		this->userdata = userdata;
+		fuse = NULL;
+		max_window = 0;
+		hits = 0;
+		misses = 0;
+		prefetched = 0;
+		wasted = 0;
+		clock = 0;
+	}
+
+	ReadAhead::~ReadAhead() {
+		std::map<Key, Stream *>::iterator it;
+
+		for (it = streams.begin(); it != streams.end(); ++it) {
+			Stream *stream = it->second;
+
+			for (size_t i = 0; i < stream->windows.size(); i++) {
+				free(stream->windows[i]->data);
+				delete stream->windows[i];
+			}
+
+			delete stream;
+		}
+	}
+
+	bool ReadAhead::Busy(Stream *stream) {
+		for (size_t i = 0; i < stream->windows.size(); i++) {
+			if (!stream->windows[i]->ready) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	ReadAhead::Stream *ReadAhead::Find(fuse_ino_t ino, uint64_t fh, bool create) {
+		Key key(ino, fh);
+		std::map<Key, Stream *>::iterator it = streams.find(key);
+
+		if (it != streams.end()) {
+			return it->second;
+		}
+
+		if (!create) {
+			return NULL;
+		}
+
+		if (streams.size() >= FUSEJS_READAHEAD_STREAMS) {
+			// A reply still points at the windows of busy streams
+			Stream *victim = NULL;
+
+			for (it = streams.begin(); it != streams.end(); ++it) {
+				if (!Busy(it->second) && (victim == NULL || it->second->used < victim->used)) {
+					victim = it->second;
+				}
+			}
+
+			if (victim == NULL) {
+				return NULL;
+			}
+
+			Reset(victim);
+			streams.erase(Key(victim->ino, victim->fh));
+			delete victim;
+		}
+
+		Stream *stream = new Stream();
+		stream->ino = ino;
+		stream->fh = fh;
+		stream->flags = 0;
+		stream->next = 0;
+		stream->ahead = 0;
+		stream->eof = UINT64_MAX;
+		stream->sequential = 0;
+		stream->window = FUSEJS_READAHEAD_MIN_WINDOW;
+		stream->closed = false;
+		stream->used = 0;
+		streams[key] = stream;
+
+		return stream;
+	}
+
+	bool ReadAhead::Read(Fuse *fuse, fuse_req_t req, uint64_t received, fuse_ino_t ino, uint64_t fh,
+	                     int flags, uint64_t offset, size_t size) {
+		if (max_window == 0 || size == 0) {
+			return false;
+		}
+
+		Stream *stream = Find(ino, fh, true);
+
+		if (stream == NULL) {
+			return false;
+		}
+
+		this->fuse = fuse;
+		stream->used = ++clock;
+		stream->flags = flags;
+		stream->ctx = *fuse_req_ctx(req);
+
+		// The kernel sends its own read-ahead in parallel, reads may
+		// arrive a little out of order and still be sequential
+		uint64_t slack = stream->window > size ? stream->window : size;
+
+		if (offset + slack >= stream->next && offset <= stream->next + slack) {
+			stream->sequential++;
+		} else {
+			Reset(stream);
+			stream->sequential = 1;
+		}
+
+		if (offset + size > stream->next) {
+			stream->next = offset + size;
+		}
+
+		Outcome outcome = Serve(stream, req, NULL, received, offset, size);
+
+		if (outcome == MISSED) {
+			if (stream->sequential > FUSEJS_READAHEAD_TRIGGER) {
+				misses++;
+			}
+
+			// Javascript reads this part itself
+			if (offset + size > stream->ahead) {
+				stream->ahead = offset + size;
+			}
+		}
+
+		Trim(stream, offset);
+		Schedule(fuse, stream);
+
+		return outcome != MISSED;
+	}
+
+	// Answers from the windows covering the read, or parks it on the
+	// window still being fetched. reply is set for reads that waited
+	// already, they may use stale windows: they were read concurrently
+	// with the change that made them stale.
+	ReadAhead::Outcome ReadAhead::Serve(Stream *stream, fuse_req_t req, Reply *reply, uint64_t received,
+	                                    uint64_t offset, size_t size) {
+		bool waited = reply != NULL;
+		uint64_t end = offset + size;
+		uint64_t pos = offset;
+		Window *pending = NULL;
+		bool eof = false;
+
+		while (pos < end && !eof) {
+			Window *window = NULL;
+
+			for (size_t i = 0; i < stream->windows.size(); i++) {
+				Window *w = stream->windows[i];
+				uint64_t limit = w->offset + (w->ready ? w->length : w->size);
+
+				if ((waited || !w->stale) && w->offset <= pos && pos < limit) {
+					window = w;
+					break;
+				}
+			}
+
+			if (window == NULL) {
+				break;
+			}
+
+			if (!window->ready) {
+				if (pending == NULL) {
+					pending = window;
+				}
+
+				pos = window->offset + window->size;
+			} else {
+				pos = window->offset + window->length;
+				// Came back short, the file ends there
+				eof = window->length < window->size;
+			}
+		}
+
+		if (pos < end && !eof) {
+			return MISSED;
+		}
+
+		if (pending != NULL) {
+			if (reply == NULL) {
+				reply = Reply::Acquire(REPLY_ID);
+				reply->Bind(req, OP_READ, received, size);
+				reply->parked = true;
+			}
+
+			Waiter waiter = { reply, reply->id, received, offset, size };
+			pending->waiters.push_back(waiter);
+			return PARKED;
+		}
+
+		struct iovec iov[FUSEJS_READAHEAD_WINDOWS];
+		Window *from[FUSEJS_READAHEAD_WINDOWS];
+		int count = 0;
+
+		pos = offset;
+		while (pos < end && count < FUSEJS_READAHEAD_WINDOWS) {
+			Window *window = NULL;
+
+			for (size_t i = 0; i < stream->windows.size(); i++) {
+				Window *w = stream->windows[i];
+
+				if ((waited || !w->stale) && w->offset <= pos && pos < w->offset + w->length) {
+					window = w;
+					break;
+				}
+			}
+
+			if (window == NULL) {
+				break;
+			}
+
+			size_t length = window->offset + window->length - pos;
+			if (length > end - pos) {
+				length = end - pos;
+			}
+
+			iov[count].iov_base = window->data + (pos - window->offset);
+			iov[count].iov_len = length;
+			from[count++] = window;
+			pos += length;
+		}
+
+		for (int i = 0; i < count; i++) {
+			from[i]->served += iov[i].iov_len;
+		}
+
+		fuse_reply_iov(req, iov, count);
+		hits++;
+
+		if (reply != NULL) {
+			reply->Finish();
+		} else {
+			Answered(req);
+		}
+
+		return SERVED;
+	}
+
+	// Requests the windows that come next, keeping one window worth of
+	// data ahead of the reader
+	void ReadAhead::Schedule(Fuse *fuse, Stream *stream) {
+		if (stream->closed || stream->sequential < FUSEJS_READAHEAD_TRIGGER) {
+			return;
+		}
+
+		if (stream->window > max_window) {
+			stream->window = max_window > FUSEJS_READAHEAD_MIN_WINDOW ? max_window
+			                                                         : FUSEJS_READAHEAD_MIN_WINDOW;
+		}
+
+		uint64_t start = stream->ahead > stream->next ? stream->ahead : stream->next;
+
+		while (stream->windows.size() < FUSEJS_READAHEAD_WINDOWS &&
+		       start < stream->next + stream->window && start < stream->eof) {
+			Window *window = new Window();
+			window->data = reinterpret_cast<char *>(malloc(stream->window));
+
+			if (window->data == NULL) {
+				delete window;
+				return;
+			}
+
+			// Counted like the reads they stand in for, released by
+			// the reply filling the window
+			if (!userdata->admission->TryAcquire(OP_READ)) {
+				free(window->data);
+				delete window;
+				return;
+			}
+
+			window->owner = this;
+			window->stream = stream;
+			window->offset = start;
+			window->size = stream->window;
+			window->length = 0;
+			window->served = 0;
+			window->ready = false;
+			window->stale = false;
+			stream->windows.push_back(window);
+
+			start += window->size;
+			stream->ahead = start;
+
+			// The handler may answer right away and drop the window
+			Proxy::Prefetch(fuse, window);
+		}
+	}
+
+	// Drops the windows the reader left behind
+	void ReadAhead::Trim(Stream *stream, uint64_t offset) {
+		for (size_t i = stream->windows.size(); i > 0; i--) {
+			Window *window = stream->windows[i - 1];
+
+			if (window->ready && (window->offset + window->length <= offset ||
+			                      window->served >= window->length)) {
+				Drop(stream, i - 1);
+			}
+		}
+	}
+
+	// Frees a window that came back, growing the window size when it
+	// was used up and shrinking it when part of it went to waste
+	void ReadAhead::Drop(Stream *stream, size_t index) {
+		Window *window = stream->windows[index];
+
+		if (window->length > 0) {
+			if (window->served >= window->length) {
+				stream->window *= 2;
+				if (stream->window > max_window) {
+					stream->window = max_window;
+				}
+			} else {
+				wasted += window->length - window->served;
+				stream->window /= 2;
+			}
+
+			if (stream->window < FUSEJS_READAHEAD_MIN_WINDOW) {
+				stream->window = FUSEJS_READAHEAD_MIN_WINDOW;
+			}
+		}
+
+		free(window->data);
+		delete window;
+		stream->windows.erase(stream->windows.begin() + index);
+	}
+
+	// Forgets the stream's position. Windows still being fetched are
+	// only marked, their replies drop them.
+	void ReadAhead::Reset(Stream *stream) {
+		for (size_t i = stream->windows.size(); i > 0; i--) {
+			Window *window = stream->windows[i - 1];
+
+			if (window->ready) {
+				Drop(stream, i - 1);
+			} else {
+				window->stale = true;
+			}
+		}
+
+		stream->ahead = 0;
+		stream->eof = UINT64_MAX;
+		stream->sequential = 0;
+		stream->window = FUSEJS_READAHEAD_MIN_WINDOW;
+	}
+
+	// Deletes a released stream once no window is in flight anymore
+	void ReadAhead::Collect(Stream *stream) {
+		Reset(stream);
+
+		if (stream->windows.empty()) {
+			streams.erase(Key(stream->ino, stream->fh));
+			delete stream;
+		}
+	}
+
+	void ReadAhead::Filled(Window *window, size_t length, int error) {
+		Stream *stream = window->stream;
+
+		window->ready = true;
+		window->length = 0;
+
+		if (error == 0) {
+			window->length = length < window->size ? length : window->size;
+			prefetched += window->length;
+
+			if (window->length < window->size && window->offset + window->length < stream->eof) {
+				stream->eof = window->offset + window->length;
+			}
+		}
+
+		std::vector<Waiter> waiters;
+		waiters.swap(window->waiters);
+
+		for (size_t i = 0; i < waiters.size(); i++) {
+			Waiter &waiter = waiters[i];
+			Reply *reply = waiter.reply;
+
+			// Expired or interrupted meanwhile, the slot may even
+			// hold another request by now
+			if (reply->id != waiter.id || !reply->Pending()) {
+				continue;
+			}
+
+			fuse_req_t req = reply->request;
+
+			if (error != 0) {
+				fuse_reply_err(req, error);
+				reply->Finish();
+			} else if (Serve(stream, req, reply, waiter.received, waiter.offset, waiter.size) != MISSED) {
+				continue;
+			} else if (waiter.offset >= stream->eof) {
+				fuse_reply_buf(req, NULL, 0);
+				reply->Finish();
+			} else {
+				// The windows around it were dropped meanwhile
+				reply->Retire();
+				Proxy::Forward(fuse, req, waiter.received, stream, waiter.offset, waiter.size);
+			}
+		}
+
+		if (stream->closed) {
+			Collect(stream);
+			return;
+		}
+
+		if (error != 0 || window->stale) {
+			for (size_t i = 0; i < stream->windows.size(); i++) {
+				if (stream->windows[i] == window) {
+					Drop(stream, i);
+					break;
+				}
+			}
+		}
+	}
+
+	void ReadAhead::Abandon(Window *window, int error) {
+		abandoned.push_back(std::make_pair(window, error));
+		uv_async_send(userdata->async);
+	}
+
+	void ReadAhead::Flush() {
+		std::vector<std::pair<Window *, int> > failed;
+		failed.swap(abandoned);
+
+		for (size_t i = 0; i < failed.size(); i++) {
+			Filled(failed[i].first, 0, failed[i].second);
+		}
+	}
+
+	void ReadAhead::Invalidate(fuse_ino_t ino) {
+		std::map<Key, Stream *>::iterator it = streams.lower_bound(Key(ino, 0));
+
+		for (; it != streams.end() && it->first.first == ino; ++it) {
+			Reset(it->second);
+		}
+	}
+
+	void ReadAhead::Close(fuse_ino_t ino, uint64_t fh) {
+		Stream *stream = Find(ino, fh, false);
+
+		if (stream == NULL) {
+			return;
+		}
+
+		stream->closed = true;
+		Collect(stream);
+	}
+
+	void ReadAhead::Answered(fuse_req_t req) {
+		userdata->admission->Release(OP_READ);
+	}
+} // namespace NodeFuse
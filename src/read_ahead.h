@@ -0,0 +1,143 @@
+#ifndef SRC_READ_AHEAD_H_
+#define SRC_READ_AHEAD_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "node_fuse.h"
+#include "filesystem.h"
+
+// Open files whose access pattern is followed, the least recently
+// read one without windows in flight makes room for a new one
+#define FUSEJS_READAHEAD_STREAMS 64
+
+// Reads in a row before anything is prefetched
+#define FUSEJS_READAHEAD_TRIGGER 2
+
+// Smallest window, in bytes. Windows double every time one is used up
+// and halve when one goes to waste, up to the readahead mount option.
+#define FUSEJS_READAHEAD_MIN_WINDOW (128 * 1024)
+
+// Windows a stream may have requested or kept at once
+#define FUSEJS_READAHEAD_WINDOWS 4
+
+namespace NodeFuse {
+	class Fuse;
+	class Reply;
+
+	// Native read-ahead. Reads are followed per (inode, file handle);
+	// once a stream reads sequentially, the read handler is called
+	// ahead of the kernel for the windows that come next and later
+	// reads are answered from what it returned. Reads landing in a
+	// window that is still being fetched wait for it instead of going
+	// to javascript a second time. Writes, truncates and releases drop
+	// what was fetched. Only used from the event loop thread; releases
+	// answered by a native handler leave their stream to be evicted.
+	class ReadAhead {
+		public:
+			struct Stream;
+
+			// A read parked on a window. A reply is bound to it so its
+			// deadline and interrupts still reach it, id tells whether
+			// the reply still belongs to it.
+			struct Waiter {
+				Reply *reply;
+				uint32_t id;
+				uint64_t received;
+				uint64_t offset;
+				size_t size;
+			};
+
+			// One speculative read, filled by a Reply bound to it
+			struct Window {
+				ReadAhead *owner;
+				Stream *stream;
+				uint64_t offset;
+				size_t size;
+				// Bytes the handler returned, fewer at the end of the file
+				size_t length;
+				// Bytes handed to reads, the rest is waste
+				size_t served;
+				char *data;
+				bool ready;
+				bool stale;
+				std::vector<Waiter> waiters;
+			};
+
+			struct Stream {
+				fuse_ino_t ino;
+				uint64_t fh;
+				int flags;
+				// Caller of the last read, prefetches run on its behalf
+				struct fuse_ctx ctx;
+				// End of the furthest read and of the furthest window
+				uint64_t next;
+				uint64_t ahead;
+				// Where the file ended, UINT64_MAX until a window came back short
+				uint64_t eof;
+				unsigned int sequential;
+				size_t window;
+				bool closed;
+				uint64_t used;
+				std::vector<Window *> windows;
+			};
+
+			ReadAhead(FileSystem::Userdata *userdata);
+			virtual ~ReadAhead();
+
+			// Called for every read before it goes to javascript, true
+			// when it was answered or will be from a window
+			bool Read(Fuse *fuse, fuse_req_t req, uint64_t received, fuse_ino_t ino, uint64_t fh,
+			          int flags, uint64_t offset, size_t size);
+			// The file changed, whatever was fetched for it is dropped
+			void Invalidate(fuse_ino_t ino);
+			// The file handle was released
+			void Close(fuse_ino_t ino, uint64_t fh);
+
+			// A prefetch was answered, with length bytes in window->data
+			// or an errno
+			void Filled(Window *window, size_t length, int error);
+			// Same for a window whose reply cannot fill it where it
+			// is, Flush does it later from the event loop
+			void Abandon(Window *window, int error);
+			void Flush();
+
+			FileSystem::Userdata *userdata;
+
+			// Largest window in bytes, 0 disables read-ahead
+			size_t max_window;
+
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t prefetched;
+			uint64_t wasted;
+
+		private:
+			typedef std::pair<fuse_ino_t, uint64_t> Key;
+
+			enum Outcome {
+				SERVED,
+				PARKED,
+				MISSED
+			};
+
+			Stream *Find(fuse_ino_t ino, uint64_t fh, bool create);
+			bool Busy(Stream *stream);
+			Outcome Serve(Stream *stream, fuse_req_t req, Reply *reply, uint64_t received,
+			              uint64_t offset, size_t size);
+			void Schedule(Fuse *fuse, Stream *stream);
+			void Trim(Stream *stream, uint64_t offset);
+			void Drop(Stream *stream, size_t index);
+			void Reset(Stream *stream);
+			void Collect(Stream *stream);
+			void Answered(fuse_req_t req);
+
+			// The mount, for the reads made from Filled
+			Fuse *fuse;
+			std::vector<std::pair<Window *, int> > abandoned;
+			std::map<Key, Stream *> streams;
+			uint64_t clock;
+	};
+} // namespace NodeFuse
+
+#endif // SRC_READ_AHEAD_H
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include "receive_pool.h"
+
+// Keeps the data of every buffer 16 byte aligned past its header
+#define RECEIVE_HEADER_SIZE ((sizeof(Block) + 15) & ~(size_t) 15)
+
+namespace NodeFuse {
+	// The buffer the calling FUSE thread is processing a request from
+	static __thread char *processing = NULL;
+	static __thread size_t processing_size = 0;
+	static __thread bool processing_claimed = false;
+
+	ReceivePool::ReceivePool(size_t keep) {
+		this->keep = keep;
+		pooled = 0;
+		free_blocks = NULL;
+		allocated = 0;
+		claimed = 0;
+
+		uv_mutex_init(&mutex);
+	}
+
+	ReceivePool::~ReceivePool() {
+		while (free_blocks != NULL) {
+			Block *block = free_blocks;
+			free_blocks = block->next;
+			free(block);
+		}
+
+		uv_mutex_destroy(&mutex);
+	}
+
+	ReceivePool::Block *ReceivePool::BlockOf(char *mem) {
+		return reinterpret_cast<Block *>(mem - RECEIVE_HEADER_SIZE);
+	}
+
+	char *ReceivePool::Get(size_t size) {
+		Block *block = NULL;
+
+		uv_mutex_lock(&mutex);
+		if (free_blocks != NULL) {
+			block = free_blocks;
+			free_blocks = block->next;
+			pooled--;
+		}
+		uv_mutex_unlock(&mutex);
+
+		// Buffers only grow when a channel wants larger ones
+		if (block != NULL && block->size < size) {
+			free(block);
+			block = NULL;
+		}
+
+		if (block == NULL) {
+			block = reinterpret_cast<Block *>(malloc(RECEIVE_HEADER_SIZE + size));
+
+			if (block == NULL) {
+				return NULL;
+			}
+
+			block->pool = this;
+			block->size = size;
+			__sync_fetch_and_add(&allocated, 1);
+		}
+
+		block->next = NULL;
+
+		return reinterpret_cast<char *>(block) + RECEIVE_HEADER_SIZE;
+	}
+
+	void ReceivePool::Put(char *mem) {
+		Block *block = BlockOf(mem);
+		ReceivePool *pool = block->pool;
+
+		uv_mutex_lock(&pool->mutex);
+		if (pool->pooled < pool->keep) {
+			block->next = pool->free_blocks;
+			pool->free_blocks = block;
+			pool->pooled++;
+			block = NULL;
+		}
+		uv_mutex_unlock(&pool->mutex);
+
+		if (block != NULL) {
+			free(block);
+		}
+	}
+
+	void ReceivePool::Processing(char *mem, size_t size) {
+		processing = mem;
+		processing_size = size;
+		processing_claimed = false;
+	}
+
+	bool ReceivePool::Claimed() {
+		return processing_claimed;
+	}
+
+	char *ReceivePool::Claim(const char *data, size_t length) {
+		if (processing == NULL || processing_claimed ||
+		    data < processing || data + length > processing + processing_size) {
+			return NULL;
+		}
+
+		processing_claimed = true;
+		__sync_fetch_and_add(&BlockOf(processing)->pool->claimed, 1);
+
+		return processing;
+	}
+
+	char *ReceivePool::Spare() {
+		if (processing == NULL) {
+			return NULL;
+		}
+
+		return BlockOf(processing)->pool->Get(processing_size);
+	}
+} // namespace NodeFuse
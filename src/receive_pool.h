@@ -0,0 +1,59 @@
+#ifndef SRC_RECEIVE_POOL_H_
+#define SRC_RECEIVE_POOL_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <uv.h>
+
+// Receive buffers kept for reuse, the rest go back to the heap
+#define FUSEJS_RECEIVE_POOL_SIZE 64
+
+namespace NodeFuse {
+	// Buffers the FUSE threads read requests into. A write does not copy
+	// its data out: it claims the buffer the data arrived in, the thread
+	// carries on with another one from the pool and the event loop gives
+	// the claimed buffer back once javascript let go of it. Get runs on
+	// the FUSE threads, Put on the event loop.
+	class ReceivePool {
+		public:
+			ReceivePool(size_t keep);
+			virtual ~ReceivePool();
+
+			// A buffer of at least size bytes, NULL when out of memory
+			char *Get(size_t size);
+			// Hands a buffer back to the pool it came from
+			static void Put(char *mem);
+
+			// Called by a FUSE thread around fuse_session_process_buf,
+			// so operation callbacks can tell whether their arguments
+			// point into the buffer being processed.
+			static void Processing(char *mem, size_t size);
+			static bool Claimed();
+
+			// The buffer being processed if data lies within it, the
+			// caller owns it from then on. NULL when data is elsewhere,
+			// libfuse then frees or reuses it after the callback.
+			static char *Claim(const char *data, size_t length);
+			// Another buffer from the pool of the one being processed,
+			// for data libfuse did not leave in it
+			static char *Spare();
+
+			volatile uint64_t allocated;
+			volatile uint64_t claimed;
+
+		private:
+			struct Block {
+				ReceivePool *pool;
+				size_t size;
+				Block *next;
+			};
+
+			static Block *BlockOf(char *mem);
+
+			size_t keep;
+			size_t pooled;
+			Block *free_blocks;
+			uv_mutex_t mutex;
+	};
+} // namespace NodeFuse
+
+#endif // SRC_RECEIVE_POOL_H
@@ -1,13 +1,110 @@
 // Copyright 2012, Camilo Aguilar. Cloudescape, LLC.
+#include <vector>
+#include <limits.h>
+#include <sys/uio.h>
 #include "reply.h"
+#include "filesystem.h"
 
 namespace NodeFuse {
 	Persistent<FunctionTemplate> Reply::constructor_template;
 
-	void Reply::Initialize() {
+	static Persistent<String> aborted_sym = NODE_PSYMBOL("aborted");
+	static Persistent<String> onabort_sym = NODE_PSYMBOL("onabort");
+	static Persistent<String> then_sym = NODE_PSYMBOL("then");
+	static Persistent<String> code_sym = NODE_PSYMBOL("code");
+	static Persistent<String> attr_timeout_sym = NODE_PSYMBOL("attr_timeout");
+	static Persistent<String> length_sym = NODE_PSYMBOL("length");
+
+	// Follows a thenable returned by a handler, a closure is the
+	// only way to carry the request through then().
+	static const char *settle_glue_source =
+		"(function (result, reply, settle) {\n"
+		"    result.then(function (value) { settle(reply, false, value); },\n"
+		"                function (reason) { settle(reply, true, reason); });\n"
+		"})";
+
+	static Persistent<Function> settle_glue;
+	static Persistent<Function> settle_function;
+
+	// Replies handed out by id, never freed. Only the event loop
+	// thread touches them so the free list needs no locking.
+	static std::vector<Reply *> reply_slots;
+	static Reply *free_replies = NULL;
+
+	// Error codes a rejection can name instead of a number
+	static const struct {
+		const char *code;
+		int value;
+	} errno_codes[] = {
+		{ "EPERM", EPERM },
+		{ "ENOENT", ENOENT },
+		{ "EINTR", EINTR },
+		{ "EIO", EIO },
+		{ "ENXIO", ENXIO },
+		{ "EBADF", EBADF },
+		{ "EAGAIN", EAGAIN },
+		{ "ENOMEM", ENOMEM },
+		{ "EACCES", EACCES },
+		{ "EFAULT", EFAULT },
+		{ "EBUSY", EBUSY },
+		{ "EEXIST", EEXIST },
+		{ "EXDEV", EXDEV },
+		{ "ENODEV", ENODEV },
+		{ "ENOTDIR", ENOTDIR },
+		{ "EISDIR", EISDIR },
+		{ "EINVAL", EINVAL },
+		{ "ENFILE", ENFILE },
+		{ "EMFILE", EMFILE },
+		{ "ETXTBSY", ETXTBSY },
+		{ "EFBIG", EFBIG },
+		{ "ENOSPC", ENOSPC },
+		{ "ESPIPE", ESPIPE },
+		{ "EROFS", EROFS },
+		{ "EMLINK", EMLINK },
+		{ "EPIPE", EPIPE },
+		{ "ERANGE", ERANGE },
+		{ "ENAMETOOLONG", ENAMETOOLONG },
+		{ "ENOLCK", ENOLCK },
+		{ "ENOSYS", ENOSYS },
+		{ "ENOTEMPTY", ENOTEMPTY },
+		{ "ELOOP", ELOOP },
+		{ "ENODATA", ENODATA },
+		{ "ENOTSUP", ENOTSUP },
+		{ "ETIMEDOUT", ETIMEDOUT },
+		{ "ECANCELED", ECANCELED },
+		{ "ESTALE", ESTALE },
+		{ "EDQUOT", EDQUOT },
+	};
+
+#define REPLY_METHOD(name)                                                  \
+	Handle<Value> Reply::name(const Arguments &args) {                      \
+		return Reply::name(ObjectWrap::Unwrap<Reply>(args.This()), args, 0); \
+	}                                                                       \
+	Handle<Value> Reply::name##ById(const Arguments &args) {                \
+		return Reply::name(Reply::Find(args[0]), args, 1);                    \
+	}
+
+	REPLY_METHOD(Entry)
+	REPLY_METHOD(Attributes)
+	REPLY_METHOD(ReadLink)
+	REPLY_METHOD(Error)
+	REPLY_METHOD(Open)
+	REPLY_METHOD(Buffer)
+	REPLY_METHOD(Fd)
+	REPLY_METHOD(Buffers)
+	REPLY_METHOD(Write)
+	REPLY_METHOD(StatFs)
+	REPLY_METHOD(Create)
+	REPLY_METHOD(XAttributes)
+	REPLY_METHOD(Lock)
+	REPLY_METHOD(BMap)
+	REPLY_METHOD(AddDirEntry)
+
+	void Reply::Initialize(Handle<Object> target) {
 		Local<FunctionTemplate> t = FunctionTemplate::New();
 
 		t->InstanceTemplate()->SetInternalFieldCount(1);
+		t->InstanceTemplate()->SetAccessor(aborted_sym, Reply::GetAborted);
 
 		NODE_SET_PROTOTYPE_METHOD(t, "entry", Reply::Entry);
 		NODE_SET_PROTOTYPE_METHOD(t, "attr", Reply::Attributes);
@@ -15,6 +112,8 @@ namespace NodeFuse {
 		NODE_SET_PROTOTYPE_METHOD(t, "err", Reply::Error);
 		NODE_SET_PROTOTYPE_METHOD(t, "open", Reply::Open);
 		NODE_SET_PROTOTYPE_METHOD(t, "buffer", Reply::Buffer);
+		NODE_SET_PROTOTYPE_METHOD(t, "fd", Reply::Fd);
+		NODE_SET_PROTOTYPE_METHOD(t, "buffers", Reply::Buffers);
 		NODE_SET_PROTOTYPE_METHOD(t, "write", Reply::Write);
 		NODE_SET_PROTOTYPE_METHOD(t, "statfs", Reply::StatFs);
 		NODE_SET_PROTOTYPE_METHOD(t, "create", Reply::Create);
@@ -23,34 +122,492 @@ namespace NodeFuse {
 
 		constructor_template = Persistent<FunctionTemplate>::New(t);
 		constructor_template->SetClassName(String::NewSymbol("Reply"));
+
+		Local<Script> glue = Script::Compile(String::New(settle_glue_source), String::New("fusejs:settle"));
+		settle_glue = Persistent<Function>::New(Local<Function>::Cast(glue->Run()));
+		settle_function = Persistent<Function>::New(FunctionTemplate::New(Reply::Settle)->GetFunction());
+
+		// Low level api, for filesystems handed request ids
+		NODE_SET_METHOD(target, "replyEntry", Reply::EntryById);
+		NODE_SET_METHOD(target, "replyAttr", Reply::AttributesById);
+		NODE_SET_METHOD(target, "replyReadlink", Reply::ReadLinkById);
+		NODE_SET_METHOD(target, "replyErr", Reply::ErrorById);
+		NODE_SET_METHOD(target, "replyOpen", Reply::OpenById);
+		NODE_SET_METHOD(target, "replyBuffer", Reply::BufferById);
+		NODE_SET_METHOD(target, "replyFd", Reply::FdById);
+		NODE_SET_METHOD(target, "replyBuffers", Reply::BuffersById);
+		NODE_SET_METHOD(target, "replyWrite", Reply::WriteById);
+		NODE_SET_METHOD(target, "replyStatfs", Reply::StatFsById);
+		NODE_SET_METHOD(target, "replyCreate", Reply::CreateById);
+		NODE_SET_METHOD(target, "replyXattr", Reply::XAttributesById);
+		NODE_SET_METHOD(target, "replyLock", Reply::LockById);
+		NODE_SET_METHOD(target, "replyBmap", Reply::BMapById);
+		NODE_SET_METHOD(target, "replyAddDirEntry", Reply::AddDirEntryById);
+		NODE_SET_METHOD(target, "requestAborted", Reply::AbortedById);
+
+		target->Set(String::NewSymbol("OPEN_DIRECT_IO"), Integer::New(OPEN_DIRECT_IO));
+		target->Set(String::NewSymbol("OPEN_KEEP_CACHE"), Integer::New(OPEN_KEEP_CACHE));
+		target->Set(String::NewSymbol("OPEN_NONSEEKABLE"), Integer::New(OPEN_NONSEEKABLE));
 	}
 
 	Reply::Reply() : ObjectWrap() {
+		mode = REPLY_OBJECT;
+		id = 0;
+		expired_id = 0;
+		expired_userdata = NULL;
+		next_free = NULL;
+		dentry_buffer = NULL;
+		loan = NULL;
+		lent_data = NULL;
+		Reset();
+	}
+
+	void Reply::Reset() {
+		request = NULL;
+		window = NULL;
+		parked = false;
+		modifies = 0;
+		limit = SIZE_MAX;
+		op = 0;
+		replied = false;
+		aborted = false;
+		expired = false;
+		deadline.prev = NULL;
+		deadline.next = NULL;
+		deadline.data = this;
+		userdata = NULL;
+		fi = NULL;
+		live_prev = NULL;
+		live_next = NULL;
 		dentry_acc_size = 0;
 		dentry_cur_length = 0;
-		dentry_buffer = NULL;
+
+		if (dentry_buffer != NULL) {
+			free(dentry_buffer);
+			dentry_buffer = NULL;
+		}
+	}
+
+	// Open replies carry the file info, keep it past the request descriptor
+	void Reply::KeepFileInfo(const struct fuse_file_info *info) {
+		file_info = *info;
+		fi = &file_info;
 	}
 
 	Reply::~Reply() {
+		// Collected without an answer, nothing can reply anymore and
+		// the caller would wait forever, deadline or not
+		if (request != NULL && !replied) {
+			userdata->timeouts_abandoned++;
+			fuse_reply_err(request, userdata->timeout_errno);
+			Finish();
+		}
+
+		// A window is failed later from the event loop, its waiters
+		// may go on to javascript which cannot run from here
+		if (window != NULL) {
+			window->owner->Abandon(window, EIO);
+			window = NULL;
+			Finish();
+		}
+
+		Unlink();
+		GiveBack();
+
 		if (dentry_buffer != NULL) {
 			free(dentry_buffer);
 		}
 	}
 
-	Handle<Value> Reply::Entry(const Arguments &args) {
+	// Replies with a javascript object are left to the garbage collector,
+	// the others come from the slots and go back there once answered.
+	Reply *Reply::Acquire(int mode) {
+		if (mode == REPLY_OBJECT) {
+			return new Reply();
+		}
+
+		Reply *reply = free_replies;
+
+		if (reply != NULL) {
+			free_replies = reply->next_free;
+			reply->next_free = NULL;
+		} else {
+			reply = new Reply();
+			reply->id = reply_slots.size();
+			reply_slots.push_back(reply);
+		}
+
+		reply->mode = mode;
+		reply->Reset();
+
+		return reply;
+	}
+
+	void Reply::Release() {
+		if (expired) {
+			expired_id = id;
+			expired_userdata = userdata;
+		}
+
+		Reset();
+
+		// A new generation so ids given out for this request go stale
+		uint32_t index = id & FUSEJS_REPLY_INDEX_MASK;
+		uint32_t generation = ((id >> FUSEJS_REPLY_INDEX_BITS) + 1) & FUSEJS_REPLY_GENERATION_MASK;
+		id = (generation << FUSEJS_REPLY_INDEX_BITS) | index;
+
+		next_free = free_replies;
+		free_replies = this;
+	}
+
+	// Looks up the reply a request id names, NULL once it was answered
+	Reply *Reply::Find(Handle<Value> value) {
+		if (!value->IsUint32()) {
+			return NULL;
+		}
+
+		uint32_t id = value->Uint32Value();
+		uint32_t index = id & FUSEJS_REPLY_INDEX_MASK;
+
+		if (index >= reply_slots.size()) {
+			return NULL;
+		}
+
+		Reply *reply = reply_slots[index];
+
+		if (reply->id != id && reply->expired_userdata != NULL && reply->expired_id == id) {
+			reply->expired_userdata->timeouts_late++;
+			return NULL;
+		}
+
+		if (reply->id != id || (reply->request == NULL && reply->window == NULL)) {
+			return NULL;
+		}
+
+		return reply;
+	}
+
+	void Reply::Bind(fuse_req_t req, int op, uint64_t received, size_t limit) {
+		this->request = req;
+		this->op = op;
+		this->limit = limit;
+		this->userdata = reinterpret_cast<FileSystem::Userdata *>(fuse_req_userdata(req));
+
+		// Keep track of unanswered requests so interrupts can find them
+		live_prev = NULL;
+		live_next = userdata->live;
+		if (live_next != NULL) {
+			live_next->live_prev = this;
+		}
+		userdata->live = this;
+
+		if (received > 0) {
+			Arm(received);
+		}
+	}
+
+	// Prefetches hold an in-flight slot the read-ahead took for them
+	// and expire like the reads they stand in for
+	void Reply::Prefetch(ReadAhead::Window *window, FileSystem::Userdata *userdata) {
+		this->window = window;
+		this->op = OP_READ;
+		this->limit = window->size;
+		this->userdata = userdata;
+
+		if (userdata->timeouts[OP_READ] > 0) {
+			Arm(uv_hrtime());
+		}
+	}
+
+	void Reply::Arm(uint64_t received) {
+		userdata->deadlines->Add(&deadline, received + userdata->timeouts[op], uv_hrtime());
+
+		if (!uv_is_active((uv_handle_t *) userdata->deadline_timer)) {
+			uv_timer_start(userdata->deadline_timer, Reply::Tick,
+			               FUSEJS_DEADLINE_RESOLUTION, FUSEJS_DEADLINE_RESOLUTION);
+		}
+	}
+
+	// Gives a parked reply's slot back without answering, its request
+	// goes on to another reply
+	void Reply::Retire() {
+		Unlink();
+		Release();
+	}
+
+	void Reply::Unlink() {
+		if (userdata == NULL) {
+			return;
+		}
+
+		userdata->deadlines->Remove(&deadline);
+
+		if (live_prev != NULL) {
+			live_prev->live_next = live_next;
+		} else if (userdata->live == this) {
+			userdata->live = live_next;
+		}
+
+		if (live_next != NULL) {
+			live_next->live_prev = live_prev;
+		}
+
+		live_prev = NULL;
+		live_next = NULL;
+	}
+
+	// Answers interrupted requests with EINTR whatever the handler
+	// meant to reply, returns true while the request still awaits one.
+	bool Reply::Pending() {
+		// A slot handed back after its reply
+		if (request == NULL) {
+			return false;
+		}
+
+		if (replied) {
+			if (expired) {
+				userdata->timeouts_late++;
+			}
+
+			return false;
+		}
+
+		if (fuse_req_interrupted(request)) {
+			aborted = true;
+			fuse_reply_err(request, EINTR);
+			userdata->interrupts_replied++;
+			Finish();
+			return false;
+		}
+
+		return true;
+	}
+
+	// Runs on the event loop for every interrupt the FUSE threads
+	// reported. The request might have been answered in the meantime,
+	// it is only touched if a reply still holds it.
+	void Reply::Abort(FileSystem::Userdata *userdata, fuse_req_t req) {
+		HandleScope scope;
+
+		for (Reply *reply = userdata->live; reply != NULL; reply = reply->live_next) {
+			if (reply->request != req) {
+				continue;
+			}
+
+			if (reply->replied || !fuse_req_interrupted(req)) {
+				return;
+			}
+
+			// Waiting on a read-ahead window, no handler to tell
+			if (reply->parked) {
+				reply->Pending();
+				return;
+			}
+
+			reply->aborted = true;
+
+			// Handlers answering through a promise have no reply object
+			if (reply->handle_.IsEmpty()) {
+				return;
+			}
+
+			Local<Object> replyObj = Local<Object>::New(reply->handle_);
+			Local<Value> onabort = replyObj->Get(onabort_sym);
+
+			if (onabort->IsFunction()) {
+				TryCatch try_catch;
+
+				Local<Function>::Cast(onabort)->Call(replyObj, 0, NULL);
+
+				if (try_catch.HasCaught()) {
+					FatalException(try_catch);
+				}
+			}
+
+			return;
+		}
+	}
+
+	// The handler did not reply in time, answer in its place so
+	// the calling process is not left waiting forever.
+	void Reply::Expire(TimingWheel::Entry *entry) {
+		Reply *reply = reinterpret_cast<Reply *>(entry->data);
+
+		reply->expired = true;
+		reply->userdata->timeouts_expired++;
+
+		// The wheel is being walked, waiters are answered later
+		if (reply->window != NULL) {
+			reply->window->owner->Abandon(reply->window, reply->userdata->timeout_errno);
+			reply->window = NULL;
+			reply->Finish();
+			return;
+		}
+
+		fuse_reply_err(reply->request, reply->userdata->timeout_errno);
+		reply->Finish();
+	}
+
+	void Reply::Tick(uv_timer_t *handle, int status) {
+		FileSystem::Userdata *userdata = reinterpret_cast<FileSystem::Userdata *>(handle->data);
+
+		userdata->deadlines->Advance(uv_hrtime(), Reply::Expire);
+
+		if (userdata->deadlines->Size() == 0) {
+			uv_timer_stop(handle);
+		}
+	}
+
+	Handle<Value> Reply::GetAborted(Local<String> property,
+	                                const AccessorInfo &info) {
+		HandleScope scope;
+
+		Reply *reply = ObjectWrap::Unwrap<Reply>(info.This());
+		if (!reply->aborted && reply->request != NULL && !reply->replied) {
+			reply->aborted = fuse_req_interrupted(reply->request);
+		}
+
+		return scope.Close(Boolean::New(reply->aborted));
+	}
+
+	// A request that no longer awaits a reply counts as aborted
+	Handle<Value> Reply::AbortedById(const Arguments &args) {
+		HandleScope scope;
+
+		Reply *reply = Reply::Find(args[0]);
+		if (reply == NULL || reply->replied) {
+			return scope.Close(True());
+		}
+
+		if (!reply->aborted) {
+			reply->aborted = fuse_req_interrupted(reply->request);
+		}
+
+		return scope.Close(Boolean::New(reply->aborted));
+	}
+
+	// Takes a FileInfo object, or the file handle and OPEN_* flags a
+	// handler given request ids replies with.
+	struct fuse_file_info *Reply::ArgumentFileInfo(const Arguments &args, int index) {
+		Local<Value> arg = args[index];
+
+		if (arg->IsObject() && FileInfo::HasInstance(arg->ToObject())) {
+			return FileInfo::Materialize(arg->ToObject())->fi;
+		}
+
+		if (fi == NULL || !arg->IsNumber()) {
+			return NULL;
+		}
+
+		fi->fh = arg->IntegerValue();
+
+		if (args[index + 1]->IsUint32()) {
+			uint32_t flags = args[index + 1]->Uint32Value();
+
+			fi->direct_io = (flags & OPEN_DIRECT_IO) != 0;
+			fi->keep_cache = (flags & OPEN_KEEP_CACHE) != 0;
+			fi->nonseekable = (flags & OPEN_NONSEEKABLE) != 0;
+		}
+
+		return fi;
+	}
+
+	// fuse_reply_* frees the request whether it succeeds or not,
+	// from here on the reply object must not touch it again.
+	void Reply::Finish() {
+		replied = true;
+		Unlink();
+		GiveBack();
+
+		if (userdata != NULL) {
+			userdata->admission->Release(op);
+
+			if (modifies != 0) {
+				userdata->readahead->Invalidate(modifies);
+			}
+		}
+
+		if (mode != REPLY_OBJECT) {
+			Release();
+		}
+	}
+
+	void Reply::FillWindow(size_t length, int error) {
+		ReadAhead::Window *filled = window;
+
+		window = NULL;
+		Finish();
+		filled->owner->Filled(filled, length, error);
+	}
+
+	Local<Value> Reply::Lend(char *block, const char *data, size_t length) {
+		HandleScope scope;
+
+		loan = new Loan();
+		loan->block = block;
+
+		node::Buffer *buffer = node::Buffer::New((char *) data, length, Reply::Reclaim, loan);
+		lent_buffer = Persistent<Object>::New(buffer->handle_);
+
+		return scope.Close(Local<Object>::New(buffer->handle_));
+	}
+
+	Local<Value> Reply::Lend(Local<Object> write_buffer) {
+		HandleScope scope;
+
+		lent_data = ObjectWrap::Unwrap<WriteBuffer>(write_buffer);
+		lent_buffer = Persistent<Object>::New(write_buffer);
+
+		return scope.Close(write_buffer);
+	}
+
+	// Empties the lent Buffer so javascript can no longer reach the
+	// receive buffer through it. Slices taken from it keep their own
+	// pointer into the block, it only goes back to the pool once the
+	// Buffer and with it every slice holding it as parent is collected.
+	// A WriteBuffer knows itself when its data can go.
+	void Reply::GiveBack() {
+		if (lent_buffer.IsEmpty()) {
+			return;
+		}
+
+		if (loan != NULL) {
+			lent_buffer->SetIndexedPropertiesToExternalArrayData(NULL, kExternalUnsignedByteArray, 0);
+			lent_buffer->Set(length_sym, Integer::New(0));
+			loan = NULL;
+		}
+
+		if (lent_data != NULL) {
+			lent_data->Release();
+			lent_data = NULL;
+		}
+
+		lent_buffer.Dispose();
+		lent_buffer.Clear();
+	}
+
+	void Reply::Reclaim(char *data, void *hint) {
+		Loan *loan = reinterpret_cast<Loan *>(hint);
+
+		ReceivePool::Put(loan->block);
+		delete loan;
+	}
+
+	Handle<Value> Reply::Entry(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify an object as first argument")));
@@ -66,6 +623,7 @@ namespace NodeFuse {
 		}
 
 		ret = fuse_reply_entry(reply->request, &entry);
+		reply->Finish();
 
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
@@ -75,20 +633,21 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Attributes(const Arguments &args) {
+	Handle<Value> Reply::Attributes(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify an object as first argument")));
@@ -105,15 +664,16 @@ namespace NodeFuse {
 
 		double timeout = 0;
 		if (argslen == 2) {
-			if (!args[1]->IsNumber()) {
+			if (!args[base + 1]->IsNumber()) {
 				FUSEJS_THROW_EXCEPTION("Invalid timeout, ", "it should be the number of seconds in which the attributes are considered valid.");
 				return Null();
 			}
 
-			timeout = args[1]->NumberValue();
+			timeout = args[base + 1]->NumberValue();
 		}
 
 		ret = fuse_reply_attr(reply->request, &statbuff, timeout);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -122,20 +682,21 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::ReadLink(const Arguments &args) {
+	Handle<Value> Reply::ReadLink(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsString()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a string as first argument")));
@@ -145,6 +706,7 @@ namespace NodeFuse {
 
 		int ret = -1;
 		ret = fuse_reply_readlink(reply->request, (const char *) *link);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -153,26 +715,33 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Error(const Arguments &args) {
+	Handle<Value> Reply::Error(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || (reply->window == NULL && !reply->Pending())) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsInt32()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a number as first argument")));
 		}
 
+		if (reply->window != NULL) {
+			reply->FillWindow(0, arg->Int32Value());
+			return Undefined();
+		}
+
 		int ret = -1;
 		ret = fuse_reply_err(reply->request, arg->Int32Value());
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -181,28 +750,28 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Open(const Arguments &args) {
+	Handle<Value> Reply::Open(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Object> fiobj = args[0]->ToObject();
-		if (!FileInfo::HasInstance(fiobj)) {
+		struct fuse_file_info *fi = reply->ArgumentFileInfo(args, base);
+		if (fi == NULL) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a FileInfo object as first argument")));
 		}
 
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(fiobj);
-
 		int ret = -1;
-		ret = fuse_reply_open(reply->request, fileInfo->fi);
+		ret = fuse_reply_open(reply->request, fi);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -211,26 +780,38 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Buffer(const Arguments &args) {
+	Handle<Value> Reply::Buffer(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || (reply->window == NULL && !reply->Pending())) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		if (!Buffer::HasInstance(args[0])) {
+		if (!Buffer::HasInstance(args[base])) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a Buffer object as first argument")));
 		}
 
-		Local<Object> buffer = args[0]->ToObject();
+		Local<Object> buffer = args[base]->ToObject();
 		const char *data = Buffer::Data(buffer);
 
+		if (reply->window != NULL) {
+			size_t length = Buffer::Length(buffer);
+			if (length > reply->window->size) {
+				length = reply->window->size;
+			}
+
+			memcpy(reply->window->data, data, length);
+			reply->FillWindow(length, 0);
+			return Undefined();
+		}
+
 		// fprintf(stderr, "\n--------------------------\n");
 		// fprintf(stderr, "Data 1: %s\n", data);
 		// fprintf(stderr, "Data 2: %d\n", reply->dentry_acc_size);
@@ -239,8 +820,10 @@ namespace NodeFuse {
 
 		if (reply->dentry_acc_size > 0) {
 			ret = fuse_reply_buf(reply->request, reply->dentry_buffer, reply->dentry_acc_size);
+			reply->Finish();
 		} else {
 			ret = fuse_reply_buf(reply->request, data, Buffer::Length(buffer));
+			reply->Finish();
 		}
 
 		// fprintf(stderr, "Data 3: %d\n", Buffer::Length(buffer));		
@@ -254,19 +837,150 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Write(const Arguments &args) {
+	// Answers with the concatenation of an array of Buffers, slices
+	// included, gathered by writev instead of being joined first
+	Handle<Value> Reply::Buffers(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || (reply->window == NULL && !reply->Pending())) {
+			return Undefined();
+		}
+
+		int argslen = args.Length() - base;
+		if (argslen == 0 || !args[base]->IsArray()) {
+			return ThrowException(Exception::TypeError(
+			                          String::New("You must specify an array of Buffers as first argument")));
+		}
+
+		Local<Array> buffers = Local<Array>::Cast(args[base]);
+		uint32_t count = buffers->Length();
+
+		// libfuse adds the header in front
+		if (count >= IOV_MAX) {
+			return ThrowException(Exception::RangeError(
+			                          String::New("Too many Buffers to reply with")));
+		}
+
+		struct iovec stack_iov[FUSEJS_REPLY_IOV];
+		struct iovec *iov = count <= FUSEJS_REPLY_IOV ? stack_iov : new struct iovec[count];
+
+		for (uint32_t i = 0; i < count; i++) {
+			Local<Value> buffer = buffers->Get(i);
+
+			if (!Buffer::HasInstance(buffer)) {
+				if (iov != stack_iov) {
+					delete[] iov;
+				}
+
+				return ThrowException(Exception::TypeError(
+				                          String::New("You must specify an array of Buffers as first argument")));
+			}
+
+			iov[i].iov_base = Buffer::Data(buffer->ToObject());
+			iov[i].iov_len = Buffer::Length(buffer->ToObject());
+		}
+
+		if (reply->window != NULL) {
+			size_t length = 0;
+
+			for (uint32_t i = 0; i < count && length < reply->window->size; i++) {
+				size_t part = iov[i].iov_len;
+				if (part > reply->window->size - length) {
+					part = reply->window->size - length;
+				}
+
+				memcpy(reply->window->data + length, iov[i].iov_base, part);
+				length += part;
+			}
 
-		int argslen = args.Length();
+			if (iov != stack_iov) {
+				delete[] iov;
+			}
+
+			reply->FillWindow(length, 0);
+			return Undefined();
+		}
+
+		int ret = fuse_reply_iov(reply->request, iov, count);
+		reply->Finish();
+
+		if (iov != stack_iov) {
+			delete[] iov;
+		}
+
+		if (ret != 0) {
+			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(-ret));
+			return Null();
+		}
+
+		return Undefined();
+	}
+
+	// Answers a read with length bytes of fd at offset. libfuse splices
+	// them from the file to the device when the kernel allows it, the
+	// data never passes through our memory then.
+	Handle<Value> Reply::Fd(Reply *reply, const Arguments &args, int base) {
+		HandleScope scope;
+
+		if (reply == NULL || (reply->window == NULL && !reply->Pending())) {
+			return Undefined();
+		}
+
+		int argslen = args.Length() - base;
+		if (argslen < 3 || !args[base]->IsInt32() || !args[base + 1]->IsNumber() ||
+		    !args[base + 2]->IsNumber()) {
+			return ThrowException(Exception::TypeError(
+			                          String::New("You must specify a file descriptor, an offset and a length")));
+		}
+
+		int64_t offset = args[base + 1]->IntegerValue();
+		int64_t length = args[base + 2]->IntegerValue();
+
+		if (offset < 0 || length < 0) {
+			return ThrowException(Exception::RangeError(
+			                          String::New("The offset and the length must not be negative")));
+		}
+
+		// The kernel refuses a reply larger than the read as a whole
+		struct fuse_bufvec bufv = FUSE_BUFVEC_INIT((uint64_t) length < reply->limit ? (size_t) length : reply->limit);
+		bufv.buf[0].flags = (enum fuse_buf_flags) (FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK | FUSE_BUF_FD_RETRY);
+		bufv.buf[0].fd = args[base]->Int32Value();
+		bufv.buf[0].pos = offset;
+
+		if (reply->window != NULL) {
+			struct fuse_bufvec dst = FUSE_BUFVEC_INIT(bufv.buf[0].size);
+			dst.buf[0].mem = reply->window->data;
+
+			ssize_t res = fuse_buf_copy(&dst, &bufv, (enum fuse_buf_copy_flags) 0);
+			reply->FillWindow(res < 0 ? 0 : res, res < 0 ? -res : 0);
+			return Undefined();
+		}
+
+		int ret = fuse_reply_data(reply->request, &bufv, (enum fuse_buf_copy_flags) 0);
+		reply->Finish();
+
+		if (ret != 0) {
+			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(-ret));
+			return Null();
+		}
+
+		return Undefined();
+	}
+
+	Handle<Value> Reply::Write(Reply *reply, const Arguments &args, int base) {
+		HandleScope scope;
+
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
+
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsNumber()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify the number of bytes written as first argument")));
@@ -274,6 +988,7 @@ namespace NodeFuse {
 
 		int ret = -1;
 		ret = fuse_reply_write(reply->request, arg->IntegerValue());
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -282,23 +997,24 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::StatFs(const Arguments &args) {
+	Handle<Value> Reply::StatFs(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
 		int ret = -1;
 		struct statvfs buf;
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a object as first argument")));
@@ -311,6 +1027,7 @@ namespace NodeFuse {
 		}
 
 		ret = fuse_reply_statfs(reply->request, &buf);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -319,20 +1036,21 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Create(const Arguments &args) {
+	Handle<Value> Reply::Create(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0 || argslen < 2) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify at least two arguments to invoke this function")));
 		}
 
-		Local<Value> params = args[0];
+		Local<Value> params = args[base];
 		if (!params->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify an object as first argument")));
@@ -347,15 +1065,14 @@ namespace NodeFuse {
 			return Null();
 		}
 
-		Local<Object> fiobj = args[1]->ToObject();
-		if (!FileInfo::HasInstance(fiobj)) {
+		struct fuse_file_info *fi = reply->ArgumentFileInfo(args, base + 1);
+		if (fi == NULL) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a FileInfo object as second argument")));
 		}
 
-		FileInfo *fileInfo = ObjectWrap::Unwrap<FileInfo>(fiobj);
-
-		ret = fuse_reply_create(reply->request, &entry, fileInfo->fi);
+		ret = fuse_reply_create(reply->request, &entry, fi);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -364,19 +1081,20 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::XAttributes(const Arguments &args) {
+	Handle<Value> Reply::XAttributes(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsInt32()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a number as first argument")));
@@ -384,6 +1102,7 @@ namespace NodeFuse {
 
 		int ret = -1;
 		ret = fuse_reply_xattr(reply->request, arg->Int32Value());
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -392,20 +1111,21 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::Lock(const Arguments &args) {
+	Handle<Value> Reply::Lock(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a Lock object as first argument")));
@@ -421,6 +1141,7 @@ namespace NodeFuse {
 		}
 
 		ret = fuse_reply_lock(reply->request, &lock);
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -429,19 +1150,20 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::BMap(const Arguments &args) {
+	Handle<Value> Reply::BMap(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 		if (argslen == 0) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify arguments to invoke this function")));
 		}
 
-		Local<Value> arg = args[0];
+		Local<Value> arg = args[base];
 		if (!arg->IsNumber()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a number as first argument")));
@@ -449,6 +1171,7 @@ namespace NodeFuse {
 
 		int ret = -1;
 		ret = fuse_reply_bmap(reply->request, arg->IntegerValue());
+		reply->Finish();
 		if (ret == -1) {
 			FUSEJS_THROW_EXCEPTION("Error replying operation: ", strerror(errno));
 			return Null();
@@ -457,41 +1180,42 @@ namespace NodeFuse {
 		return Undefined();
 	}
 
-	Handle<Value> Reply::AddDirEntry(const Arguments &args) {
+	Handle<Value> Reply::AddDirEntry(Reply *reply, const Arguments &args, int base) {
 		HandleScope scope;
 
-		Local<Object> replyObj = args.This();
-		Reply *reply = ObjectWrap::Unwrap<Reply>(replyObj);
+		if (reply == NULL || !reply->Pending()) {
+			return Undefined();
+		}
 
-		int argslen = args.Length();
+		int argslen = args.Length() - base;
 
 		if (argslen == 0 || argslen < 4) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify five arguments to invoke this function")));
 		}
 
-		if (!args[0]->IsString()) {
+		if (!args[base]->IsString()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify an entry name String as first argument")));
 		}
 
-		if (!args[1]->IsNumber()) {
+		if (!args[base + 1]->IsNumber()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify the requested size number as second argument")));
 		}
 
-		if (!args[2]->IsObject()) {
+		if (!args[base + 2]->IsObject()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify stat Object as third argument")));
 		}
 
-		if (!args[3]->IsNumber()) {
+		if (!args[base + 3]->IsNumber()) {
 			return ThrowException(Exception::TypeError(
 			                          String::New("You must specify a offset number as fourth argument")));
 		}
 
-		String::Utf8Value name(args[0]->ToString());
-		size_t requestedSize = args[1]->IntegerValue();
+		String::Utf8Value name(args[base]->ToString());
+		size_t requestedSize = args[base + 1]->IntegerValue();
 
 		if (reply->dentry_buffer == NULL) {
 			reply->dentry_buffer = (char *) malloc(requestedSize * sizeof(char));
@@ -500,9 +1224,9 @@ namespace NodeFuse {
 		char *buffer = reply->dentry_buffer;
 
 		struct stat statbuff;
-		ObjectToStat(args[2]->ToObject(), &statbuff);
+		ObjectToStat(args[base + 2]->ToObject(), &statbuff);
 
-		off_t offset = args[3]->IntegerValue();
+		off_t offset = args[base + 3]->IntegerValue();
 
 		size_t acc_size = reply->dentry_acc_size;
 
@@ -517,11 +1241,8 @@ namespace NodeFuse {
 		// fprintf(stderr, "Remaning buffer -> %d\n", (int)(requestedSize - acc_size));
 
 		if (len > (requestedSize - acc_size)) {
-			int ret = fuse_reply_buf(reply->request, NULL, 0);
-
-			if (ret == -1) {
-				fuse_reply_err(reply->request, EIO);
-			}
+			fuse_reply_buf(reply->request, NULL, 0);
+			reply->Finish();
 
 			return Undefined();
 		}
@@ -532,4 +1253,253 @@ namespace NodeFuse {
 		return scope.Close(Integer::New(len));
 	}
 
+	void Reply::Await(Reply *reply, Handle<Value> result) {
+		HandleScope scope;
+
+		if (!result.IsEmpty() && result->IsObject() &&
+		    result->ToObject()->Get(then_sym)->IsFunction()) {
+			// The wrapper keeps a wrapped reply alive until the promise settles,
+			// the others are passed by id since their slot may be reused.
+			Local<Value> target = reply->mode == REPLY_OBJECT ? Local<Value>::New(reply->handle_)
+			                                                  : Local<Value>(Integer::NewFromUnsigned(reply->id));
+			Local<Value> argv[3] = { Local<Value>::New(result), target, Local<Value>::New(settle_function) };
+
+			TryCatch try_catch;
+
+			settle_glue->Call(Context::GetCurrent()->Global(), 3, argv);
+
+			if (try_catch.HasCaught()) {
+				if (reply->mode != REPLY_OBJECT) {
+					reply->Fail(try_catch.Exception());
+				}
+
+				FatalException(try_catch);
+			}
+
+			return;
+		}
+
+		// Handlers given a reply object or an id answer through it
+		if (reply->mode != REPLY_RETURN) {
+			return;
+		}
+
+		if (result.IsEmpty()) {
+			// The handler threw
+			reply->Fail(Undefined());
+		} else {
+			reply->Complete(result);
+		}
+	}
+
+	Handle<Value> Reply::Settle(const Arguments &args) {
+		HandleScope scope;
+
+		Reply *reply = args[0]->IsObject() ? ObjectWrap::Unwrap<Reply>(args[0]->ToObject())
+		                                   : Reply::Find(args[0]);
+		bool rejected = args[1]->BooleanValue();
+
+		// Answered meanwhile, or expired and already reused
+		if (reply == NULL) {
+			return scope.Close(Undefined());
+		}
+
+		if (rejected) {
+			reply->Fail(args[2]);
+		} else if (reply->mode == REPLY_RETURN) {
+			reply->Complete(args[2]);
+		}
+
+		return scope.Close(Undefined());
+	}
+
+	// Maps the value a handler resolved to onto the reply its operation expects
+	void Reply::Complete(Handle<Value> value) {
+		HandleScope scope;
+
+		if (window != NULL) {
+			if (!Buffer::HasInstance(value)) {
+				fprintf(stderr, "fuse: unexpected value resolved for operation %d\n", op);
+				FillWindow(0, EIO);
+				return;
+			}
+
+			size_t length = Buffer::Length(value->ToObject());
+			if (length > window->size) {
+				length = window->size;
+			}
+
+			memcpy(window->data, Buffer::Data(value->ToObject()), length);
+			FillWindow(length, 0);
+			return;
+		}
+
+		if (!Pending()) {
+			return;
+		}
+
+		bool answered = true;
+
+		switch (op) {
+			case OP_LOOKUP:
+			case OP_MKNOD:
+			case OP_MKDIR:
+			case OP_SYMLINK:
+			case OP_LINK:
+			case OP_CREATE: {
+				struct fuse_entry_param entry;
+
+				if (!value->IsObject() || ObjectToFuseEntryParam(value, &entry) == -1) {
+					answered = false;
+					break;
+				}
+
+				if (op == OP_CREATE) {
+					fuse_reply_create(request, &entry, fi);
+				} else {
+					fuse_reply_entry(request, &entry);
+				}
+				break;
+			}
+			case OP_GETATTR:
+			case OP_SETATTR: {
+				struct stat statbuff;
+
+				if (!value->IsObject() || ObjectToStat(value, &statbuff) == -1) {
+					answered = false;
+					break;
+				}
+
+				Local<Value> timeout = value->ToObject()->Get(attr_timeout_sym);
+				fuse_reply_attr(request, &statbuff, timeout->IsNumber() ? timeout->NumberValue() : 0);
+				break;
+			}
+			case OP_READLINK: {
+				if (!value->IsString()) {
+					answered = false;
+					break;
+				}
+
+				String::Utf8Value link(value->ToString());
+				fuse_reply_readlink(request, (const char *) *link);
+				break;
+			}
+			case OP_OPEN:
+			case OP_OPENDIR: {
+				struct fuse_file_info *info = fi;
+
+				if (value->IsObject() && FileInfo::HasInstance(value->ToObject())) {
+					info = FileInfo::Materialize(value->ToObject())->fi;
+				}
+
+				fuse_reply_open(request, info);
+				break;
+			}
+			case OP_READ:
+			case OP_READDIR:
+			case OP_GETXATTR:
+			case OP_LISTXATTR: {
+				// Asked for the size of the attribute value or list
+				if ((op == OP_GETXATTR || op == OP_LISTXATTR) && value->IsNumber()) {
+					fuse_reply_xattr(request, value->IntegerValue());
+					break;
+				}
+
+				if (!Buffer::HasInstance(value)) {
+					answered = false;
+					break;
+				}
+
+				fuse_reply_buf(request, Buffer::Data(value->ToObject()), Buffer::Length(value->ToObject()));
+				break;
+			}
+			case OP_WRITE:
+				if (!value->IsNumber()) {
+					answered = false;
+					break;
+				}
+
+				fuse_reply_write(request, value->IntegerValue());
+				break;
+			case OP_STATFS: {
+				struct statvfs buf;
+
+				if (!value->IsObject() || ObjectToStatVfs(value, &buf) == -1) {
+					answered = false;
+					break;
+				}
+
+				fuse_reply_statfs(request, &buf);
+				break;
+			}
+			case OP_GETLK: {
+				struct flock lock;
+
+				if (!value->IsObject() || ObjectToFlock(value, &lock) == -1) {
+					answered = false;
+					break;
+				}
+
+				fuse_reply_lock(request, &lock);
+				break;
+			}
+			case OP_BMAP:
+				if (!value->IsNumber()) {
+					answered = false;
+					break;
+				}
+
+				fuse_reply_bmap(request, value->IntegerValue());
+				break;
+			default:
+				// Nothing to return but success
+				fuse_reply_err(request, 0);
+				break;
+		}
+
+		if (!answered) {
+			// Not what the operation replies with
+			fprintf(stderr, "fuse: unexpected value resolved for operation %d\n", op);
+			fuse_reply_err(request, EIO);
+		}
+
+		Finish();
+	}
+
+	// A number is taken as the errno, an Error by its code, EIO otherwise
+	void Reply::Fail(Handle<Value> reason) {
+		HandleScope scope;
+
+		if (window == NULL && !Pending()) {
+			return;
+		}
+
+		int error = EIO;
+
+		if (!reason.IsEmpty() && reason->IsNumber()) {
+			error = abs(reason->Int32Value());
+		} else if (!reason.IsEmpty() && reason->IsObject()) {
+			Local<Value> code = reason->ToObject()->Get(code_sym);
+
+			if (code->IsString()) {
+				String::Utf8Value name(code->ToString());
+
+				for (size_t i = 0; i < sizeof(errno_codes) / sizeof(errno_codes[0]); i++) {
+					if (strcmp(errno_codes[i].code, *name) == 0) {
+						error = errno_codes[i].value;
+						break;
+					}
+				}
+			}
+		}
+
+		if (window != NULL) {
+			FillWindow(0, error > 0 ? error : EIO);
+			return;
+		}
+
+		fuse_reply_err(request, error > 0 ? error : EIO);
+		Finish();
+	}
+
 } //ends namespace NodeFuse
@@ -6,37 +6,177 @@
 #include "node_buffer.h"
 #include "node_fuse.h"
 #include "file_info.h"
+#include "filesystem.h"
+#include "receive_pool.h"
+#include "write_buffer.h"
+#include "read_ahead.h"
+
+// Buffers a buffers reply gathers without allocating
+#define FUSEJS_REPLY_IOV 16
+
+// Request ids carry the slot index and a generation, so an id kept
+// after its request was answered does not name the next one.
+#define FUSEJS_REPLY_INDEX_BITS 20
+#define FUSEJS_REPLY_INDEX_MASK ((1 << FUSEJS_REPLY_INDEX_BITS) - 1)
+#define FUSEJS_REPLY_GENERATION_MASK ((1 << (31 - FUSEJS_REPLY_INDEX_BITS)) - 1)
 
 namespace NodeFuse {
+	// How a handler answers its request
+	enum ReplyMode {
+		REPLY_OBJECT = 0,   // through a Reply object
+		REPLY_RETURN,       // with its return value or promise
+		REPLY_ID            // calling replyX(id, ...) functions
+	};
+
+	// Flags replyOpen and replyCreate take after the file handle
+	enum OpenFlags {
+		OPEN_DIRECT_IO = 1,
+		OPEN_KEEP_CACHE = 2,
+		OPEN_NONSEEKABLE = 4
+	};
+
 	class Reply : public ObjectWrap {
 			friend class Proxy;
+			friend class ReadAhead;
 
 		public:
-			static void Initialize();
+			static void Initialize(Handle<Object> target);
 
 			Reply();
 			virtual ~Reply();
 
+			static Reply *Acquire(int mode);
+			static Reply *Find(Handle<Value> value);
+
+			void Bind(fuse_req_t req, int op, uint64_t received, size_t limit);
+			// Answers a read-ahead window instead of a request: the data
+			// is copied into it and nothing goes to the kernel
+			void Prefetch(ReadAhead::Window *window, FileSystem::Userdata *userdata);
+
+			static void Abort(FileSystem::Userdata *userdata, fuse_req_t req);
+			static void Tick(uv_timer_t *handle, int status);
+
+			// Answers from the value a handler returned: a thenable is
+			// followed natively, anything else completes a handler that
+			// was not given a reply object.
+			static void Await(Reply *reply, Handle<Value> result);
+
+			// Wraps data lying in a claimed receive buffer in a Buffer
+			// without copying it. The Buffer is emptied once the request
+			// is answered, the receive buffer goes back to the pool once
+			// the Buffer and its slices are collected.
+			Local<Value> Lend(char *block, const char *data, size_t length);
+			// Same for a WriteBuffer, released once the request is answered
+			Local<Value> Lend(Local<Object> write_buffer);
+
 		protected:
+			// Reply object methods, and their module level
+			// counterparts taking the request id first
 			static Handle<Value> Entry(const Arguments &args);
+			static Handle<Value> EntryById(const Arguments &args);
 			static Handle<Value> Attributes(const Arguments &args);
+			static Handle<Value> AttributesById(const Arguments &args);
 			static Handle<Value> ReadLink(const Arguments &args);
+			static Handle<Value> ReadLinkById(const Arguments &args);
 			static Handle<Value> Error(const Arguments &args);
+			static Handle<Value> ErrorById(const Arguments &args);
 			static Handle<Value> Open(const Arguments &args);
+			static Handle<Value> OpenById(const Arguments &args);
 			static Handle<Value> Buffer(const Arguments &args);
+			static Handle<Value> BufferById(const Arguments &args);
+			static Handle<Value> Fd(const Arguments &args);
+			static Handle<Value> FdById(const Arguments &args);
+			static Handle<Value> Buffers(const Arguments &args);
+			static Handle<Value> BuffersById(const Arguments &args);
 			static Handle<Value> Write(const Arguments &args);
+			static Handle<Value> WriteById(const Arguments &args);
 			static Handle<Value> StatFs(const Arguments &args);
+			static Handle<Value> StatFsById(const Arguments &args);
 			static Handle<Value> Create(const Arguments &args);
+			static Handle<Value> CreateById(const Arguments &args);
 			static Handle<Value> XAttributes(const Arguments &args);
+			static Handle<Value> XAttributesById(const Arguments &args);
 			static Handle<Value> Lock(const Arguments &args);
+			static Handle<Value> LockById(const Arguments &args);
 			static Handle<Value> BMap(const Arguments &args);
+			static Handle<Value> BMapById(const Arguments &args);
 			static Handle<Value> AddDirEntry(const Arguments &args);
+			static Handle<Value> AddDirEntryById(const Arguments &args);
+			static Handle<Value> GetAborted(Local<String> property,
+			                                const AccessorInfo &info);
+			static Handle<Value> AbortedById(const Arguments &args);
+			static Handle<Value> Settle(const Arguments &args);
 
 		private:
+			// Shared by both apis, base is the index of the first argument
+			static Handle<Value> Entry(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Attributes(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> ReadLink(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Error(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Open(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Buffer(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Fd(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Buffers(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Write(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> StatFs(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Create(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> XAttributes(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> Lock(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> BMap(Reply *reply, const Arguments &args, int base);
+			static Handle<Value> AddDirEntry(Reply *reply, const Arguments &args, int base);
+
+			void Reset();
+			void KeepFileInfo(const struct fuse_file_info *info);
+			void Release();
+			bool Pending();
+			void Finish();
+			void FillWindow(size_t length, int error);
+			void Arm(uint64_t received);
+			void Retire();
+			void Unlink();
+			void GiveBack();
+			static void Reclaim(char *data, void *hint);
+			struct fuse_file_info *ArgumentFileInfo(const Arguments &args, int index);
+			static void Expire(TimingWheel::Entry *entry);
+			void Complete(Handle<Value> value);
+			void Fail(Handle<Value> reason);
+
+			int mode;
+			uint32_t id;
+			// Id of the last request of the slot that expired, late
+			// answers to it are still counted once the slot moved on
+			uint32_t expired_id;
+			FileSystem::Userdata *expired_userdata;
+			Reply *next_free;
 			fuse_req_t request;
+			ReadAhead::Window *window;
+			// A read waiting on a read-ahead window, answered natively
+			bool parked;
+			// Inode whose read-ahead goes stale once this is answered
+			fuse_ino_t modifies;
+			// Most bytes the request asked for
+			size_t limit;
+			int op;
+			bool replied;
+			bool aborted;
+			bool expired;
+			TimingWheel::Entry deadline;
+			FileSystem::Userdata *userdata;
+			struct fuse_file_info *fi;
+			struct fuse_file_info file_info;
+			Reply *live_prev;
+			Reply *live_next;
 			size_t dentry_acc_size;
 			size_t dentry_cur_length;
 			char *dentry_buffer;
+			// Receive buffer lent to javascript, handed back by the
+			// Buffer's free callback
+			struct Loan {
+				char *block;
+			};
+			Loan *loan;
+			WriteBuffer *lent_data;
+			Persistent<Object> lent_buffer;
 			static Persistent<FunctionTemplate> constructor_template;
 	};
 } //namespace NodeFuse
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include "request_queue.h"
+
+namespace NodeFuse {
+	RequestQueue::RequestQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		cells = new Cell[size];
+		mask = size - 1;
+
+		for (size_t i = 0; i < size; i++) {
+			cells[i].sequence = i;
+			cells[i].data = NULL;
+		}
+
+		enqueue_pos = 0;
+		dequeue_pos = 0;
+	}
+
+	RequestQueue::~RequestQueue() {
+		delete[] cells;
+	}
+
+	bool RequestQueue::Push(void *item) {
+		Cell *cell;
+		size_t pos = enqueue_pos;
+
+		for (;;) {
+			cell = &cells[pos & mask];
+			size_t seq = cell->sequence;
+			__sync_synchronize();
+
+			intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+			if (dif == 0) {
+				if (__sync_bool_compare_and_swap(&enqueue_pos, pos, pos + 1)) {
+					break;
+				}
+				pos = enqueue_pos;
+			} else if (dif < 0) {
+				// Ring is full
+				return false;
+			} else {
+				pos = enqueue_pos;
+			}
+		}
+
+		cell->data = item;
+		__sync_synchronize();
+		cell->sequence = pos + 1;
+
+		return true;
+	}
+
+	void *RequestQueue::Pop() {
+		size_t pos = dequeue_pos;
+		Cell *cell = &cells[pos & mask];
+
+		size_t seq = cell->sequence;
+		__sync_synchronize();
+
+		if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) {
+			// Empty, or the producer that claimed this cell
+			// has not published it yet.
+			return NULL;
+		}
+
+		void *item = cell->data;
+		__sync_synchronize();
+		cell->sequence = pos + mask + 1;
+		dequeue_pos = pos + 1;
+
+		return item;
+	}
+
+	size_t RequestQueue::Size() {
+		size_t tail = dequeue_pos;
+		size_t head = enqueue_pos;
+
+		return head > tail ? head - tail : 0;
+	}
+} // namespace NodeFuse
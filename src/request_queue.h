@@ -0,0 +1,37 @@
+#ifndef SRC_REQUEST_QUEUE_H_
+#define SRC_REQUEST_QUEUE_H_
+#include <stddef.h>
+
+#define REQUEST_QUEUE_CACHELINE 64
+
+namespace NodeFuse {
+	// Bounded lock-free ring used to hand requests from the FUSE thread(s)
+	// over to the V8 thread. Any number of threads may Push, only the
+	// event loop thread may Pop. Capacity is rounded up to a power of two.
+	class RequestQueue {
+		public:
+			RequestQueue(size_t capacity);
+			virtual ~RequestQueue();
+
+			bool Push(void *item);
+			void *Pop();
+			size_t Size();
+
+		private:
+			struct Cell {
+				volatile size_t sequence;
+				void *data;
+			};
+
+			Cell *cells;
+			size_t mask;
+
+			char pad0[REQUEST_QUEUE_CACHELINE];
+			volatile size_t enqueue_pos;
+			char pad1[REQUEST_QUEUE_CACHELINE];
+			volatile size_t dequeue_pos;
+			char pad2[REQUEST_QUEUE_CACHELINE];
+	};
+} // namespace NodeFuse
+
+#endif // SRC_REQUEST_QUEUE_H
@@ -0,0 +1,170 @@
+#include <string.h>
+#include "request_slab.h"
+#include "receive_pool.h"
+#include "splice_pipe.h"
+
+namespace NodeFuse {
+	RequestSlab::RequestSlab(size_t capacity) {
+		this->capacity = capacity;
+		slots = new ThreadFunData[capacity];
+
+		for (size_t i = 0; i < capacity; i++) {
+			slots[i].slab = this;
+			slots[i].index = i;
+			slots[i].next = i + 1 < capacity ? i + 1 : REQUEST_SLAB_NONE;
+		}
+
+		head = capacity > 0 ? 0 : REQUEST_SLAB_NONE;
+		in_use = 0;
+		peak = 0;
+		overflows = 0;
+	}
+
+	RequestSlab::~RequestSlab() {
+		delete[] slots;
+	}
+
+	ThreadFunData *RequestSlab::Acquire() {
+		ThreadFunData *data = NULL;
+
+		for (;;) {
+			uint64_t current = head;
+			uint32_t index = (uint32_t) current;
+
+			if (index == REQUEST_SLAB_NONE) {
+				break;
+			}
+
+			// Might be stale if another thread took the slot meanwhile,
+			// the tag makes the swap fail in that case.
+			uint32_t next = slots[index].next;
+			uint64_t replacement = (((current >> 32) + 1) << 32) | next;
+
+			if (__sync_bool_compare_and_swap(&head, current, replacement)) {
+				data = &slots[index];
+				break;
+			}
+		}
+
+		if (data == NULL) {
+			data = new ThreadFunData();
+			data->slab = this;
+			data->index = REQUEST_SLAB_NONE;
+			__sync_fetch_and_add(&overflows, 1);
+		}
+
+		uint32_t used = __sync_add_and_fetch(&in_use, 1);
+		uint32_t highest = peak;
+		while (used > highest && !__sync_bool_compare_and_swap(&peak, highest, used)) {
+			highest = peak;
+		}
+
+		data->names_used = 0;
+		for (int i = 0; i < FUSEJS_REQUEST_SPILLS; i++) {
+			data->spilled[i] = NULL;
+		}
+		data->block = NULL;
+		data->pipe = NULL;
+
+		return data;
+	}
+
+	void RequestSlab::Release(ThreadFunData *data) {
+		for (int i = 0; i < FUSEJS_REQUEST_SPILLS; i++) {
+			if (data->spilled[i] != NULL) {
+				delete[] data->spilled[i];
+			}
+		}
+
+		if (data->block != NULL) {
+			ReceivePool::Put(data->block);
+		}
+
+		if (data->pipe != NULL) {
+			SplicePipe::Put(data->pipe);
+		}
+
+		__sync_fetch_and_sub(&in_use, 1);
+
+		if (data->index == REQUEST_SLAB_NONE) {
+			delete data;
+			return;
+		}
+
+		for (;;) {
+			uint64_t current = head;
+			data->next = (uint32_t) current;
+			uint64_t replacement = (((current >> 32) + 1) << 32) | data->index;
+
+			if (__sync_bool_compare_and_swap(&head, current, replacement)) {
+				return;
+			}
+		}
+	}
+
+	const char *ThreadFunData::CopyName(const char *name) {
+		return Copy(name, strlen(name));
+	}
+
+	// Keeps a NUL terminated copy of data for as long as the request
+	const char *ThreadFunData::Copy(const char *data, size_t length) {
+		if (data == NULL) {
+			return NULL;
+		}
+
+		char *copy = Reserve(length + 1);
+
+		memcpy(copy, data, length);
+		copy[length] = 0;
+
+		return copy;
+	}
+
+	// Memory that lives as long as the request
+	char *ThreadFunData::Reserve(size_t length) {
+		char *memory;
+
+		if (names_used + length <= FUSEJS_REQUEST_NAME_SIZE) {
+			memory = names + names_used;
+			names_used += length;
+		} else {
+			memory = new char[length];
+
+			for (int i = 0; i < FUSEJS_REQUEST_SPILLS; i++) {
+				if (spilled[i] == NULL) {
+					spilled[i] = memory;
+					break;
+				}
+			}
+		}
+
+		return memory;
+	}
+
+	struct fuse_file_info *ThreadFunData::CopyFileInfo(const struct fuse_file_info *info) {
+		if (info == NULL) {
+			return NULL;
+		}
+
+		fi = *info;
+		return &fi;
+	}
+
+	struct stat *ThreadFunData::CopyStat(const struct stat *stat) {
+		if (stat == NULL) {
+			return NULL;
+		}
+
+		attr = *stat;
+		return &attr;
+	}
+
+	struct flock *ThreadFunData::CopyFlock(const struct flock *flock) {
+		if (flock == NULL) {
+			return NULL;
+		}
+
+		lock = *flock;
+		return &lock;
+	}
+} // namespace NodeFuse
@@ -0,0 +1,92 @@
+#ifndef SRC_REQUEST_SLAB_H_
+#define SRC_REQUEST_SLAB_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <fuse_lowlevel.h>
+
+// Descriptors every mount keeps ready, requests beyond that are
+// allocated on the heap and counted as overflows.
+#define FUSEJS_REQUEST_SLAB_SIZE 1024
+
+// Bytes kept for an operation's typed arguments, see OpTraits
+#define FUSEJS_REQUEST_PAYLOAD 64
+
+// Bytes kept inline for the names a request carries, longer ones
+// spill to the heap. Rename and symlink carry two.
+#define FUSEJS_REQUEST_NAME_SIZE 256
+#define FUSEJS_REQUEST_SPILLS 2
+
+#define REQUEST_SLAB_NONE 0xffffffff
+
+namespace NodeFuse {
+	class RequestSlab;
+	struct SplicePipe;
+
+	// What a FUSE thread hands over to the event loop for one request.
+	// libfuse reuses its buffers as soon as the operation callback
+	// returns, so names, file info, attributes and locks are copied.
+	struct ThreadFunData {
+		fuse_req_t req;
+		int op;
+		// uv_hrtime() when the FUSE thread got the request,
+		// 0 when the operation has no deadline
+		uint64_t received;
+
+		// OpTraits<op>::Request, read through RequestOf<op>()
+		union {
+			char bytes[FUSEJS_REQUEST_PAYLOAD];
+			uint64_t align;
+			void *pointer;
+		} payload;
+
+		struct fuse_file_info fi;
+		struct stat attr;
+		struct flock lock;
+		char names[FUSEJS_REQUEST_NAME_SIZE];
+		size_t names_used;
+		char *spilled[FUSEJS_REQUEST_SPILLS];
+		// Receive buffer the request claimed, see ReceivePool. Given
+		// back with the descriptor unless a reply took it over.
+		char *block;
+		// Pipe spliced write data was moved into, given back likewise
+		SplicePipe *pipe;
+
+		// Slab the descriptor goes back to, index in it or
+		// REQUEST_SLAB_NONE when allocated on the heap
+		RequestSlab *slab;
+		uint32_t index;
+		uint32_t next;
+
+		const char *CopyName(const char *name);
+		const char *Copy(const char *data, size_t length);
+		char *Reserve(size_t length);
+		struct fuse_file_info *CopyFileInfo(const struct fuse_file_info *info);
+		struct stat *CopyStat(const struct stat *stat);
+		struct flock *CopyFlock(const struct flock *flock);
+	};
+
+	// Fixed pool of request descriptors. Any FUSE thread may Acquire,
+	// the event loop Releases; the free list is a lock-free stack whose
+	// head carries a tag against ABA.
+	class RequestSlab {
+		public:
+			RequestSlab(size_t capacity);
+			virtual ~RequestSlab();
+
+			ThreadFunData *Acquire();
+			void Release(ThreadFunData *data);
+
+			size_t capacity;
+			volatile uint32_t in_use;
+			volatile uint32_t peak;
+			volatile uint64_t overflows;
+
+		private:
+			ThreadFunData *slots;
+			volatile uint64_t head;
+	};
+} // namespace NodeFuse
+
+#endif // SRC_REQUEST_SLAB_H
@@ -0,0 +1,120 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "splice_pipe.h"
+
+namespace NodeFuse {
+	static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+	static SplicePipe *pool = NULL;
+	static size_t pooled = 0;
+
+	static void Close(SplicePipe *pipe) {
+		close(pipe->fds[0]);
+		close(pipe->fds[1]);
+		delete pipe;
+	}
+
+	SplicePipe *SplicePipe::Get(size_t capacity) {
+		SplicePipe *pipe = NULL;
+
+		pthread_mutex_lock(&pool_mutex);
+		if (pool != NULL) {
+			pipe = pool;
+			pool = pipe->next;
+			pooled--;
+		}
+		pthread_mutex_unlock(&pool_mutex);
+
+		if (pipe == NULL) {
+			pipe = new SplicePipe();
+			pipe->capacity = 0;
+			pipe->size = 0;
+
+			if (pipe2(pipe->fds, O_CLOEXEC | O_NONBLOCK) == -1) {
+				delete pipe;
+				return NULL;
+			}
+		}
+
+		pipe->next = NULL;
+
+#ifdef F_SETPIPE_SZ
+		if (pipe->capacity < capacity) {
+			int size = fcntl(pipe->fds[0], F_SETPIPE_SZ, (int) capacity);
+
+			if (size == -1) {
+				Close(pipe);
+				return NULL;
+			}
+
+			pipe->capacity = size;
+		}
+#endif
+
+		if (pipe->capacity < capacity) {
+			Close(pipe);
+			return NULL;
+		}
+
+		return pipe;
+	}
+
+	void SplicePipe::Put(SplicePipe *pipe) {
+		if (pipe->size > 0) {
+			Close(pipe);
+			return;
+		}
+
+		pthread_mutex_lock(&pool_mutex);
+		if (pooled < FUSEJS_SPLICE_PIPE_POOL) {
+			pipe->next = pool;
+			pool = pipe;
+			pooled++;
+			pipe = NULL;
+		}
+		pthread_mutex_unlock(&pool_mutex);
+
+		if (pipe != NULL) {
+			Close(pipe);
+		}
+	}
+
+	size_t SplicePipe::Fill(struct fuse_bufvec *bufv, size_t length) {
+		struct fuse_bufvec dst = FUSE_BUFVEC_INIT(length);
+		dst.buf[0].flags = FUSE_BUF_IS_FD;
+		dst.buf[0].fd = fds[1];
+
+		ssize_t moved = fuse_buf_copy(&dst, bufv, (enum fuse_buf_copy_flags)
+		                              (FUSE_BUF_SPLICE_MOVE | FUSE_BUF_SPLICE_NONBLOCK));
+
+		if (moved <= 0) {
+			return 0;
+		}
+
+		size += moved;
+
+		return moved;
+	}
+
+	bool SplicePipe::Drain(char *mem, size_t length) {
+		size_t done = 0;
+
+		while (done < length) {
+			ssize_t res = read(fds[0], mem + done, length - done);
+
+			if (res == -1 && errno == EINTR) {
+				continue;
+			}
+
+			if (res <= 0) {
+				return false;
+			}
+
+			done += res;
+			size -= res;
+		}
+
+		return true;
+	}
+} // namespace NodeFuse
@@ -0,0 +1,33 @@
+#ifndef SRC_SPLICE_PIPE_H_
+#define SRC_SPLICE_PIPE_H_
+#include <stddef.h>
+#include <fuse_lowlevel.h>
+
+// Empty pipes kept for reuse, shared by all mounts
+#define FUSEJS_SPLICE_PIPE_POOL 64
+
+namespace NodeFuse {
+	// A pipe write data spliced from the fuse device is moved into. The
+	// pipe libfuse spliced it to is reused for the next request, moving
+	// the pages on to a pipe of our own keeps them out of user memory
+	// until a handler forwards them to a file descriptor.
+	struct SplicePipe {
+		int fds[2];
+		size_t capacity;
+		// Bytes waiting in the pipe
+		size_t size;
+		SplicePipe *next;
+
+		// A pipe holding at least capacity bytes, NULL if none can be made
+		static SplicePipe *Get(size_t capacity);
+		// Pipes still holding data are closed, the others kept
+		static void Put(SplicePipe *pipe);
+
+		// Moves up to length bytes of bufv in, returns how many
+		size_t Fill(struct fuse_bufvec *bufv, size_t length);
+		// Reads length bytes out into memory, false on failure
+		bool Drain(char *mem, size_t length);
+	};
+} // namespace NodeFuse
+
+#endif // SRC_SPLICE_PIPE_H
@@ -0,0 +1,93 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "thread.h"
+
+namespace NodeFuse {
+	bool Thread::ParseCpus(const char *list, CpuSet *set) {
+		const char *p = list;
+
+		set->count = 0;
+
+		while (*p != '\0') {
+			char *end;
+			unsigned long first = strtoul(p, &end, 10);
+			unsigned long last = first;
+
+			if (end == p) {
+				return false;
+			}
+
+			if (*end == '-') {
+				p = end + 1;
+				last = strtoul(p, &end, 10);
+
+				if (end == p || last < first) {
+					return false;
+				}
+			}
+
+			for (unsigned long cpu = first; cpu <= last; cpu++) {
+				if (set->count == FUSEJS_MAX_CPUS || cpu >= 65536) {
+					return false;
+				}
+
+				set->cpus[set->count++] = (unsigned short) cpu;
+			}
+
+			if (*end == ':' || *end == ',') {
+				end++;
+			} else if (*end != '\0') {
+				return false;
+			}
+
+			p = end;
+		}
+
+		return set->count > 0;
+	}
+
+	int Thread::Pin(pthread_t thread, const CpuSet *set) {
+#ifdef __linux__
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+
+		for (unsigned int i = 0; i < set->count; i++) {
+			if (set->cpus[i] >= CPU_SETSIZE) {
+				return EINVAL;
+			}
+
+			CPU_SET(set->cpus[i], &cpus);
+		}
+
+		return pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+#else
+		return ENOSYS;
+#endif
+	}
+
+	int Thread::Pin(pthread_t thread, const CpuSet *set, unsigned int index) {
+		CpuSet single;
+
+		single.count = 1;
+		single.cpus[0] = set->cpus[index % set->count];
+
+		return Pin(thread, &single);
+	}
+
+	void Thread::SetName(const char *name) {
+#if defined(__linux__)
+		char truncated[16];
+
+		strncpy(truncated, name, sizeof(truncated) - 1);
+		truncated[sizeof(truncated) - 1] = '\0';
+		pthread_setname_np(pthread_self(), truncated);
+#elif defined(__APPLE__)
+		pthread_setname_np(name);
+#endif
+	}
+} // namespace NodeFuse
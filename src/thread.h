@@ -0,0 +1,34 @@
+#ifndef SRC_THREAD_H_
+#define SRC_THREAD_H_
+#include <pthread.h>
+
+// Most CPUs a single affinity option can list
+#define FUSEJS_MAX_CPUS 256
+
+namespace NodeFuse {
+	// Naming and CPU pinning of the threads the binding runs,
+	// so they show up in top/perf and can be kept off noisy cores.
+	class Thread {
+		public:
+			// CPUs in the order they were listed
+			struct CpuSet {
+				unsigned int count;
+				unsigned short cpus[FUSEJS_MAX_CPUS];
+			};
+
+			// Parses a list such as "0-3:8", entries may also be separated by
+			// commas. Returns false when malformed.
+			static bool ParseCpus(const char *list, CpuSet *set);
+
+			// Restricts the thread to every CPU of the set, or to a
+			// single one, the index-th of the set modulo its size.
+			// Return 0 or an errno value.
+			static int Pin(pthread_t thread, const CpuSet *set);
+			static int Pin(pthread_t thread, const CpuSet *set, unsigned int index);
+
+			// Names the calling thread, at most 15 characters are kept
+			static void SetName(const char *name);
+	};
+} // namespace NodeFuse
+
+#endif // SRC_THREAD_H
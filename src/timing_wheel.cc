@@ -0,0 +1,90 @@
+#include "timing_wheel.h"
+
+namespace NodeFuse {
+	TimingWheel::TimingWheel(uint64_t resolution, size_t slots) {
+		size_t size = 2;
+		while (size < slots) {
+			size <<= 1;
+		}
+
+		// Every slot is the head of a circular list
+		this->slots = new Entry[size];
+		for (size_t i = 0; i < size; i++) {
+			this->slots[i].prev = &this->slots[i];
+			this->slots[i].next = &this->slots[i];
+		}
+
+		this->mask = size - 1;
+		this->resolution = resolution > 0 ? resolution : 1;
+		this->current = 0;
+		this->count = 0;
+	}
+
+	TimingWheel::~TimingWheel() {
+		delete[] slots;
+	}
+
+	void TimingWheel::Add(Entry *entry, uint64_t deadline, uint64_t now) {
+		if (count == 0) {
+			// Nothing ticked while the wheel was empty
+			current = now / resolution;
+		}
+
+		uint64_t tick = (deadline + resolution - 1) / resolution;
+		if (tick <= current) {
+			tick = current + 1;
+		}
+
+		Entry *head = &slots[tick & mask];
+
+		entry->expires = tick;
+		entry->prev = head->prev;
+		entry->next = head;
+		head->prev->next = entry;
+		head->prev = entry;
+
+		count++;
+	}
+
+	void TimingWheel::Remove(Entry *entry) {
+		if (entry->prev == NULL) {
+			return;
+		}
+
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+		entry->prev = NULL;
+		entry->next = NULL;
+
+		count--;
+	}
+
+	void TimingWheel::Advance(uint64_t now, ExpireCallback callback) {
+		uint64_t target = now / resolution;
+
+		// One turn visits every slot, anything older is due anyway
+		if (target > current + mask + 1) {
+			current = target - mask - 1;
+		}
+
+		while (current < target && count > 0) {
+			current++;
+
+			Entry *head = &slots[current & mask];
+			Entry *entry = head->next;
+
+			while (entry != head) {
+				Entry *next = entry->next;
+
+				if (entry->expires <= current) {
+					Remove(entry);
+					callback(entry);
+				}
+
+				entry = next;
+			}
+		}
+
+		current = target;
+	}
+} // namespace NodeFuse
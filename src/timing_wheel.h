@@ -0,0 +1,44 @@
+#ifndef SRC_TIMING_WHEEL_H_
+#define SRC_TIMING_WHEEL_H_
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NodeFuse {
+	// Hashed timing wheel keeping the deadlines of pending requests.
+	// Adding and removing an entry is O(1) and entries are intrusive,
+	// so tracking a request costs no allocation. Deadlines further
+	// away than a full turn stay in their slot until their round
+	// comes up. Only used from the event loop thread.
+	class TimingWheel {
+		public:
+			struct Entry {
+				Entry *prev;
+				Entry *next;
+				uint64_t expires;
+				void *data;
+			};
+
+			typedef void (*ExpireCallback)(Entry *entry);
+
+			// resolution in nanoseconds, slots rounded up to a power of two
+			TimingWheel(uint64_t resolution, size_t slots);
+			virtual ~TimingWheel();
+
+			// deadline and now are uv_hrtime() values
+			void Add(Entry *entry, uint64_t deadline, uint64_t now);
+			void Remove(Entry *entry);
+			void Advance(uint64_t now, ExpireCallback callback);
+
+			size_t Size() { return count; }
+			static bool Linked(Entry *entry) { return entry->prev != NULL; }
+
+		private:
+			Entry *slots;
+			size_t mask;
+			uint64_t resolution;
+			uint64_t current;
+			size_t count;
+	};
+} // namespace NodeFuse
+
+#endif // SRC_TIMING_WHEEL_H
@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "write_buffer.h"
+#include "receive_pool.h"
+#include "node_buffer.h"
+
+namespace NodeFuse {
+	Persistent<FunctionTemplate> WriteBuffer::constructor_template;
+
+	static Persistent<String> length_sym = NODE_PSYMBOL("length");
+
+	void WriteBuffer::Initialize() {
+		Local<FunctionTemplate> t = FunctionTemplate::New();
+
+		t->InstanceTemplate()->SetInternalFieldCount(1);
+		t->InstanceTemplate()->SetAccessor(length_sym, WriteBuffer::GetLength);
+
+		NODE_SET_PROTOTYPE_METHOD(t, "copyTo", WriteBuffer::CopyTo);
+		NODE_SET_PROTOTYPE_METHOD(t, "toBuffer", WriteBuffer::ToBuffer);
+
+		constructor_template = Persistent<FunctionTemplate>::New(t);
+		constructor_template->SetClassName(String::NewSymbol("WriteBuffer"));
+	}
+
+	WriteBuffer::WriteBuffer() : ObjectWrap() {
+		block = NULL;
+		owned = NULL;
+		data = NULL;
+		pipe = NULL;
+		length = 0;
+		taken = false;
+		busy = false;
+		released = false;
+	}
+
+	WriteBuffer::~WriteBuffer() {
+		Drop();
+	}
+
+	Local<Object> WriteBuffer::New(char *block, const char *data, SplicePipe *pipe, size_t length) {
+		HandleScope scope;
+		Local<Object> object = constructor_template->GetFunction()->NewInstance();
+		WriteBuffer *buffer = new WriteBuffer();
+
+		buffer->block = block;
+		buffer->data = data;
+		buffer->pipe = pipe;
+		buffer->length = length;
+
+		if (block == NULL && pipe == NULL) {
+			buffer->owned = reinterpret_cast<char *>(malloc(length));
+
+			if (buffer->owned != NULL) {
+				memcpy(buffer->owned, data, length);
+			} else {
+				fprintf(stderr, "fuse: unable to allocate %lu bytes of write data\n", (unsigned long) length);
+				buffer->length = 0;
+			}
+
+			buffer->data = buffer->owned;
+		}
+
+		buffer->Wrap(object);
+
+		return scope.Close(object);
+	}
+
+	void WriteBuffer::Release() {
+		released = true;
+
+		if (!busy) {
+			Drop();
+		}
+	}
+
+	void WriteBuffer::Drop() {
+		if (block != NULL) {
+			ReceivePool::Put(block);
+			block = NULL;
+		}
+
+		if (pipe != NULL) {
+			SplicePipe::Put(pipe);
+			pipe = NULL;
+		}
+
+		if (owned != NULL) {
+			free(owned);
+			owned = NULL;
+		}
+
+		data = NULL;
+	}
+
+	bool WriteBuffer::Take() {
+		if (taken || released) {
+			return false;
+		}
+
+		taken = true;
+
+		return true;
+	}
+
+	// Writes everything at offset, splicing from the pipe when the data
+	// is in one. Returns the bytes written or a negated errno.
+	ssize_t WriteBuffer::CopyToFd(int fd, off_t offset) {
+		struct fuse_bufvec dst = FUSE_BUFVEC_INIT(length);
+		struct fuse_bufvec src = FUSE_BUFVEC_INIT(length);
+
+		dst.buf[0].flags = (enum fuse_buf_flags) (FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK | FUSE_BUF_FD_RETRY);
+		dst.buf[0].fd = fd;
+		dst.buf[0].pos = offset;
+
+		if (pipe != NULL) {
+			src.buf[0].flags = FUSE_BUF_IS_FD;
+			src.buf[0].fd = pipe->fds[0];
+		} else {
+			src.buf[0].mem = (void *) data;
+		}
+
+		ssize_t res = fuse_buf_copy(&dst, &src, FUSE_BUF_SPLICE_MOVE);
+
+		if (pipe != NULL && res > 0) {
+			pipe->size -= res;
+		}
+
+		return res;
+	}
+
+	void WriteBuffer::CopyWork(uv_work_t *work) {
+		Copy *copy = reinterpret_cast<Copy *>(work->data);
+
+		copy->result = copy->source->CopyToFd(copy->fd, copy->offset);
+	}
+
+	void WriteBuffer::CopyDone(uv_work_t *work, int status) {
+		HandleScope scope;
+
+		Copy *copy = reinterpret_cast<Copy *>(work->data);
+		WriteBuffer *source = copy->source;
+
+		source->busy = false;
+		source->Drop();
+
+		Local<Value> argv[2];
+		if (copy->result < 0) {
+			argv[0] = Exception::Error(String::Concat(String::New("Error copying write data: "),
+			                                          String::New(strerror(-copy->result))));
+			argv[1] = Local<Value>::New(Undefined());
+		} else {
+			argv[0] = Local<Value>::New(Null());
+			argv[1] = Number::New(copy->result);
+		}
+
+		TryCatch try_catch;
+
+		copy->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+
+		if (try_catch.HasCaught()) {
+			FatalException(try_catch);
+		}
+
+		copy->callback.Dispose();
+		source->Unref();
+		delete copy;
+	}
+
+	Handle<Value> WriteBuffer::CopyTo(const Arguments &args) {
+		HandleScope scope;
+
+		WriteBuffer *buffer = ObjectWrap::Unwrap<WriteBuffer>(args.This());
+
+		if (args.Length() < 2 || !args[0]->IsInt32() || !args[1]->IsNumber()) {
+			return ThrowException(Exception::TypeError(
+			                          String::New("You must specify a file descriptor and an offset")));
+		}
+
+		if (!buffer->Take()) {
+			return ThrowException(Exception::Error(
+			                          String::New("The write data was already taken or the write answered")));
+		}
+
+		int fd = args[0]->Int32Value();
+		off_t offset = args[1]->IntegerValue();
+
+		// Leaves the event loop alone while the data goes to disk
+		if (args.Length() > 2 && args[2]->IsFunction()) {
+			Copy *copy = new Copy();
+			copy->work.data = copy;
+			copy->source = buffer;
+			copy->fd = fd;
+			copy->offset = offset;
+			copy->result = 0;
+			copy->callback = Persistent<Function>::New(Local<Function>::Cast(args[2]));
+
+			buffer->busy = true;
+			buffer->Ref();
+			uv_queue_work(uv_default_loop(), &copy->work, WriteBuffer::CopyWork, WriteBuffer::CopyDone);
+
+			return Undefined();
+		}
+
+		ssize_t res = buffer->CopyToFd(fd, offset);
+		buffer->Drop();
+
+		if (res < 0) {
+			FUSEJS_THROW_EXCEPTION("Error copying write data: ", strerror(-res));
+			return Null();
+		}
+
+		return scope.Close(Number::New(res));
+	}
+
+	Handle<Value> WriteBuffer::ToBuffer(const Arguments &args) {
+		HandleScope scope;
+
+		WriteBuffer *source = ObjectWrap::Unwrap<WriteBuffer>(args.This());
+
+		if (!source->Take()) {
+			return ThrowException(Exception::Error(
+			                          String::New("The write data was already taken or the write answered")));
+		}
+
+		node::Buffer *buffer = node::Buffer::New(source->length);
+		char *copy = node::Buffer::Data(buffer->handle_);
+		bool read = true;
+
+		if (source->pipe != NULL) {
+			read = source->pipe->Drain(copy, source->length);
+		} else {
+			memcpy(copy, source->data, source->length);
+		}
+
+		source->Drop();
+
+		if (!read) {
+			FUSEJS_THROW_EXCEPTION("Error reading write data: ", strerror(errno));
+			return Null();
+		}
+
+		return scope.Close(Local<Object>::New(buffer->handle_));
+	}
+
+	Handle<Value> WriteBuffer::GetLength(Local<String> property, const AccessorInfo &info) {
+		HandleScope scope;
+
+		WriteBuffer *buffer = ObjectWrap::Unwrap<WriteBuffer>(info.This());
+
+		return scope.Close(Number::New(buffer->length));
+	}
+} // namespace NodeFuse
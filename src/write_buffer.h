@@ -0,0 +1,62 @@
+#ifndef SRC_WRITE_BUFFER_H_
+#define SRC_WRITE_BUFFER_H_
+#include <stddef.h>
+#include "node_fuse.h"
+#include "splice_pipe.h"
+
+namespace NodeFuse {
+	// The data of a write handed to a handler whose splice property is
+	// set. It stays in a claimed receive buffer or, when the kernel
+	// spliced it, in a pipe, and is forwarded to a file descriptor with
+	// fuse_buf_copy so the bytes never reach the javascript heap. The
+	// data can be taken once, and only until the write is answered.
+	class WriteBuffer : public ObjectWrap {
+		public:
+			static void Initialize();
+
+			// Takes over the receive buffer block or the pipe, data
+			// found in neither is copied since its owner goes away
+			static Local<Object> New(char *block, const char *data, SplicePipe *pipe, size_t length);
+
+			// The write was answered, gives the data back as soon as
+			// no copy is running anymore
+			void Release();
+
+			WriteBuffer();
+			virtual ~WriteBuffer();
+
+		protected:
+			static Handle<Value> CopyTo(const Arguments &args);
+			static Handle<Value> ToBuffer(const Arguments &args);
+			static Handle<Value> GetLength(Local<String> property, const AccessorInfo &info);
+
+		private:
+			struct Copy {
+				uv_work_t work;
+				WriteBuffer *source;
+				int fd;
+				off_t offset;
+				ssize_t result;
+				Persistent<Function> callback;
+			};
+
+			static void CopyWork(uv_work_t *work);
+			static void CopyDone(uv_work_t *work, int status);
+
+			bool Take();
+			ssize_t CopyToFd(int fd, off_t offset);
+			void Drop();
+
+			char *block;
+			char *owned;
+			const char *data;
+			SplicePipe *pipe;
+			size_t length;
+			bool taken;
+			bool busy;
+			bool released;
+			static Persistent<FunctionTemplate> constructor_template;
+	};
+} //namespace NodeFuse
+
+#endif  // SRC_WRITE_BUFFER_H